@@ -1,3 +1,6 @@
+#include <deque>
+#include <memory>
+#include <regex>
 #include "assembler.h"
 #include "symboltable.h"
 #include "assemblyexpressionevaluator.h"
@@ -5,9 +8,11 @@
 #include "binarywriter_intelhex.h"
 #include "binarywriter_elfos.h"
 #include "binarywriter_binary.h"
+#include "codeimage.h"
 #include "expressionexception.h"
 #include "listingfilewriter.h"
 #include "sourcecodereader.h"
+#include "sourceline.h"
 #include "symboltable.h"
 #include "utils.h"
 
@@ -34,8 +39,9 @@ const std::map<std::string, Assembler::OutputFormatEnum> Assembler::OutputFormat
     { "BIN",       Assembler::OutputFormatEnum::BIN       }
 };
 
-Assembler::Assembler(const std::string& FileName, CPUTypeEnum& InitialProcessor, bool ListingEnabled, bool DumpSymbols, bool& NoRegisters, bool& NoPorts, const std::vector<OutputFormatEnum>& BinMode) :
+Assembler::Assembler(const std::string& FileName, const std::vector<std::string>& PreProcessedSource, CPUTypeEnum& InitialProcessor, bool ListingEnabled, bool DumpSymbols, bool& NoRegisters, bool& NoPorts, const std::vector<OutputFormatEnum>& BinMode) :
     FileName(FileName),
+    PreProcessedSource(PreProcessedSource),
     InitialProcessor(InitialProcessor),
     NoRegisters(NoRegisters),
     NoPorts(NoPorts),
@@ -56,23 +62,26 @@ bool Assembler::Run()
 {
     SymbolTable MainTable;
     std::map<std::string, SymbolTable> SubTables;
-    std::map<uint16_t, std::vector<uint8_t>> Code;
-    std::map<uint16_t, std::vector<uint8_t>>::iterator CurrentCode;
+    CodeImage Image;
+    std::vector<CodeSource> CodeSources;    // Lines processed during pass 3, tagging writes to the Image
     std::optional<uint16_t> EntryPoint;
     std::set<std::string> UnReferencedSubs;
+    std::deque<SourceLine> Program;
+    std::vector<DeferredEqu> DeferredEqus;  // EQUs of Pass 2 evaluated on first use, checked at the end of it
+    int LayoutPasses = 0;                   // Repeats of Pass 2 for SUBROUTINE sizes measured in the layout
 
     // Pre-Define LABELS for Registers
     if(!NoRegisters)
         for(int i=0; i<16; i++)
         {
-            MainTable.Symbols[fmt::format("R{n}",   fmt::arg("n", i))] = { i, true };
-            MainTable.Symbols[fmt::format("R{n:X}", fmt::arg("n", i))] = { i, true };
+            MainTable.Symbol(SymbolNames::Id(fmt::format("R{n}",   fmt::arg("n", i)))) = { i, true };
+            MainTable.Symbol(SymbolNames::Id(fmt::format("R{n:X}", fmt::arg("n", i)))) = { i, true };
         }
     // Pre-Define LABELS for Ports
     if(!NoPorts)
         for(int i=1; i<8; i++)
         {
-            MainTable.Symbols[fmt::format("P{n}",   fmt::arg("n", i))] = { i, true };
+            MainTable.Symbol(SymbolNames::Id(fmt::format("P{n}",   fmt::arg("n", i)))) = { i, true };
         }
 
     ErrorTable Errors;
@@ -85,111 +94,117 @@ bool Assembler::Run()
         SymbolTable* CurrentTable = &MainTable;
         uint16_t ProgramCounter = 0;
         uint16_t SubroutineSize = 0;
+        bool SubroutineSized = true;        // False if a line's size is only known once laid out in Pass 2
         CPUTypeEnum Processor = InitialProcessor;
-        std::string CurrentFile = "";
-        std::string SubDefinitionFile = "";
+        SourceNameId CurrentFile = SourceNames::None;
+        SourceNameId SubDefinitionFile = SourceNames::None;
         int LineNumber = 0;
         bool InSub = false;
+        SourceLine* SubStart = nullptr;     // Opening line of the SUBROUTINE being defined in Pass 1
         bool InAutoAlignedSub = false;
+        uint16_t SubAddress = 0;            // Start of the SUBROUTINE being laid out in Pass 2
+        bool LayoutChanged = false;         // Set if an AUTO aligned SUBROUTINE was laid out for the wrong size
         TotalPadBytes = 0;
 
-        Code.clear();
-        Code = {{ 0, {}}};
-        CurrentCode = Code.begin();
+        Image.Clear();
+        CodeSources.clear();
+        DeferredEqus.clear();
 
         try
         {
             fmt::println("Pass {pass}", fmt::arg("pass", Pass));
 
-            // Setup Source File stack
-            SourceCodeReader Source(FileName);
+            // Setup Source stack. Pass 1 reads the pre-processed source and records each line,
+            // later passes replay the recorded lines.
+            std::unique_ptr<SourceCodeReader> Reader;
+            if(Pass == 1)
+                Reader = std::make_unique<SourceCodeReader>(PreProcessedSource, Program);
+            else
+                Reader = std::make_unique<SourceCodeReader>(Program);
+            SourceCodeReader& Source = *Reader;
 
             // Setup stack of #if results
             int IfNestingLevel = 0;
 
             // Read and process each line
-            std::string OriginalLine;
-            while(Source.getLine(OriginalLine))
+            SourceLine* Current;
+            while(Source.getLine(Current))
             {
-                std::string Line = Trim(OriginalLine);
+                if(!Current->Lexed)
+                    Lex(*Current);
+                const std::string& Line = Current->Trimmed;
 
                 // Check for Pre-Processor Control statement (#control expression...)
-                std::smatch MatchResult;
-                if(regex_match(Line, MatchResult, std::regex(R"-(^#(\w+)(\s+(.*))?$)-")))
+                if(Current->LineType == SourceLine::LineTypeEnum::LINE_CONTROL)
                 {
-                    std::string ControlWord = MatchResult[1];
-                    std::string Expression = MatchResult[3];
-                    if(PreProcessorControlLookup.find(ControlWord) != PreProcessorControlLookup.end())
+                    const std::string& Expression = Current->Expression;
+                    switch(Current->Control)
                     {
-                        switch(PreProcessorControlLookup.at(ControlWord))
+                        case PreProcessorControlEnum::PP_LINE:
+                        {
+                            if(Current->MarkerLine.has_value())
+                            {
+                                CurrentFile = Current->MarkerFile;
+                                LineNumber = Current->MarkerLine.value();
+                            }
+                            else
+                                throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
+                            break;
+                        }
+                        case PreProcessorControlEnum::PP_PROCESSOR:
                         {
-                            case PreProcessorControlEnum::PP_LINE:
+                            if(Pass == 3)
+                                ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                            auto CPU = OpCodeTable::FindCPU(Expression);
+                            if(CPU)
+                                Processor = CPU.value();
+                            else
+                                throw AssemblyException("Bad processor directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
+                            if(!Source.InMacro())
+                                LineNumber++;
+                            break;
+                        }
+                        case PreProcessorControlEnum::PP_LIST:
+                            if(Pass == 3)
                             {
-                                std::smatch MatchResult;
-                                std::string NewFile;
-                                if(regex_match(Expression, MatchResult, std::regex(R"-(^"(.*)" ([0-9]+)$)-")))
+                                if(Expression == "ON")
+                                {
+                                    ListingFile.Enabled = true;
+                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                }
+                                else if(Expression == "OFF")
                                 {
-                                    CurrentFile = MatchResult[1];
-                                    LineNumber = stoi(MatchResult[2]);
+                                    if(ListingFile.Enabled)
+                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                    ListingFile.Enabled = false;
                                 }
                                 else
-                                    throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                break;
+                                    throw AssemblyException("Bad list directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
                             }
-                            case PreProcessorControlEnum::PP_PROCESSOR:
+                            if(!Source.InMacro())
+                                LineNumber++;
+                            break;
+                        case PreProcessorControlEnum::PP_SYMBOLS:
+                            if(Pass == 3)
                             {
-                                if(Pass == 3)
-                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                ToUpper(Expression);
-                                if(OpCodeTable::CPUTable.find(Expression) != OpCodeTable::CPUTable.end())
-                                    Processor = OpCodeTable::CPUTable.at(Expression);
+                                ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                if(Expression == "ON")
+                                    DumpSymbols = true;
+                                else if(Expression == "OFF")
+                                    DumpSymbols = false;
                                 else
-                                    throw AssemblyException("Bad processor directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                if(!Source.InMacro())
-                                    LineNumber++;
-                                break;
+                                    throw AssemblyException("Bad symbols directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
                             }
-                            case PreProcessorControlEnum::PP_LIST:
-                                if(Pass == 3)
-                                {
-                                    ToUpper(Expression);
-                                    if(Expression == "ON")
-                                    {
-                                        ListingFile.Enabled = true;
-                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                    }
-                                    else if(Expression == "OFF")
-                                    {
-                                        if(ListingFile.Enabled)
-                                            ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                        ListingFile.Enabled = false;
-                                    }
-                                    else
-                                        throw AssemblyException("Bad list directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                }
-                                if(!Source.InMacro())
-                                    LineNumber++;
-                                break;
-                            case PreProcessorControlEnum::PP_SYMBOLS:
-                                if(Pass == 3)
-                                {
-                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                    ToUpper(Expression);
-                                    if(Expression == "ON")
-                                        DumpSymbols = true;
-                                    else if(Expression == "OFF")
-                                        DumpSymbols = false;
-                                    else
-                                        throw AssemblyException("Bad symbols directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                }
-                                if(!Source.InMacro())
-                                    LineNumber++;
-                                break;
-                        }
-                        continue; // Go back to start of getLine loop - control statements have no further processing.
+                            if(!Source.InMacro())
+                                LineNumber++;
+                            break;
                     }
+                    continue; // Go back to start of getLine loop - control statements have no further processing.
+                }
+                else if(Current->LineType == SourceLine::LineTypeEnum::LINE_DIRECTIVE)
+                {
                     if(Pass == 3)
-                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                 }
                 else
                 {
@@ -202,10 +217,11 @@ bool Assembler::Run()
                                 InSub = false;
                                 throw AssemblyException("Subroutine definition must be within a single source file", AssemblyErrorSeverity::SEVERITY_Error);
                             }
-                            std::string Label;
-                            std::string Mnemonic;
-                            std::vector<std::string>Operands;
-                            std::optional<OpCodeSpec> OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
+                            const std::optional<OpCodeSpec>& OpCode = ExpandTokens(*Current);
+                            const std::string& Label = Current->Label;
+                            const SymbolId LabelId = Current->LabelId;
+                            const std::string& Mnemonic = Current->Mnemonic;
+                            const std::vector<std::string>& Operands = Current->Operands;
 
                             switch(Pass)
                             {
@@ -213,6 +229,22 @@ bool Assembler::Run()
                                 {
                                     if(OpCode)
                                     {
+                                        // Record the size of the line for the layout. A count that refers to symbols
+                                        // is left to Pass 2, which then measures the SUBROUTINE holding it.
+                                        try
+                                        {
+                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
+                                            Current->Size = LineSize(OpCode.value(), Operands, E);
+                                        }
+                                        catch (ExpressionException Ex)
+                                        {
+                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
+                                        }
+                                        if(Current->Size.has_value())
+                                            SubroutineSize += Current->Size.value();
+                                        else
+                                            SubroutineSized = false;
+
                                         if(OpCode.value().OpCodeType == OpCodeTypeEnum::PSEUDO_OP)
                                         {
                                             switch(OpCode.value().OpCode)
@@ -228,18 +260,26 @@ bool Assembler::Run()
                                                         throw AssemblyException(fmt::format("Subroutine '{Label}' is already defined", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error, OpCodeEnum::ENDSUB);
 
                                                     InSub = true;
+                                                    SubStart = Current;
                                                     SubDefinitionFile = CurrentFile;
                                                     SubTables.insert(std::pair<std::string, SymbolTable>(Label, SymbolTable()));
                                                     CurrentTable = &SubTables[Label];
                                                     SubroutineSize = 0;
+                                                    SubroutineSized = true;
                                                     break;
                                                 case OpCodeEnum::ENDSUB:
                                                 {
                                                     if(!InSub)
                                                         throw AssemblyException("ENDSUB without matching SUB", AssemblyErrorSeverity::SEVERITY_Error);
                                                     InSub = false;
+                                                    SubStart->BodyEnd = Source.Index();
+                                                    SubStart->BodyEndLineNumber = LineNumber;
+                                                    SubStart->BodyEndFile = CurrentFile;
 
-                                                    CurrentTable->CodeSize = SubroutineSize;
+                                                    if(SubroutineSized)
+                                                        CurrentTable->CodeSize = SubroutineSize;
+                                                    else
+                                                        CurrentTable->CodeSize.reset();
                                                     CurrentTable = &MainTable;
                                                     break;
                                                 }
@@ -247,19 +287,18 @@ bool Assembler::Run()
                                                 {
                                                     if(CurrentTable->Macros.find(Label) != CurrentTable->Macros.end())
                                                         throw AssemblyException(fmt::format("Macro '{Macro}' is already defined", fmt::arg("Macro", Label)), AssemblyErrorSeverity::SEVERITY_Error, OpCodeEnum::ENDMACRO);
-                                                    if(OpCodeTable::OpCode.find(Label) != OpCodeTable::OpCode.end())
+                                                    if(OpCodeTable::FindOpCode(Label))
                                                         throw AssemblyException(fmt::format("Cannot use reserved word '{OpCode}' as a Macro name", fmt::arg("OpCode", Label)), AssemblyErrorSeverity::SEVERITY_Error, OpCodeEnum::ENDMACRO);
                                                     Macro& MacroDefinition = CurrentTable->Macros[Label];
-                                                    std::regex ArgMatch(R"(^[A-Z_][A-Z0-9_]*$)");
                                                     for(auto& Arg : Operands)
                                                     {
                                                         std::string Argument(Arg);
                                                         ToUpper(Argument);
 
-                                                        if(OpCodeTable::OpCode.find(Argument) != OpCodeTable::OpCode.cend())
+                                                        if(OpCodeTable::FindOpCode(Argument))
                                                             throw AssemblyException(fmt::format("Cannot use reserved word '{OpCode}' as a Macro parameter", fmt::arg("OpCode", Argument)), AssemblyErrorSeverity::SEVERITY_Error, OpCodeEnum::ENDMACRO);
 
-                                                        if(std::regex_match(Argument, ArgMatch))
+                                                        if(IsIdentifier(Argument))
                                                             if(std::find(MacroDefinition.Arguments.begin(), MacroDefinition.Arguments.end(), Argument) == MacroDefinition.Arguments.end())
                                                                 MacroDefinition.Arguments.push_back(Argument);
                                                             else
@@ -268,44 +307,32 @@ bool Assembler::Run()
                                                             throw AssemblyException(fmt::format("Invalid argument name: '{Name}'", fmt::arg("Name", Argument)), AssemblyErrorSeverity::SEVERITY_Error);
                                                     }
 
-                                                    std::ostringstream Expansion;
-                                                    while(Source.getLine(OriginalLine))
+                                                    SourceLine* Start = Current;
+                                                    while(Source.getLine(Current))
                                                     {
                                                         LineNumber++;
-                                                        std::string Line = Trim(OriginalLine);
+                                                        if(!Current->Lexed)
+                                                            Lex(*Current);
 
                                                         // Throw an error if the source file changes mid definition
-                                                        if(regex_match(Line, MatchResult, std::regex(R"-(^#(\w+)(\s+(.*))?$)-")))
-                                                        {
-                                                            std::string ControlWord = MatchResult[1];
-                                                            std::string Expression = MatchResult[3];
-                                                            if(PreProcessorControlLookup.find(ControlWord) != PreProcessorControlLookup.end()
-                                                                    && PreProcessorControlLookup.at(ControlWord) == PreProcessorControlEnum::PP_LINE
-                                                                    && regex_match(Expression, MatchResult, std::regex(R"-(^"(.*)" ([0-9]+)$)-"))
-                                                                    && CurrentFile != MatchResult[1])
-                                                                throw AssemblyException("Macro definition must be within a single source file", AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-
-                                                        std::optional<OpCodeSpec> OpCode;
-                                                        try
-                                                        {
-                                                            OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
-                                                        }
-                                                        catch(AssemblyException Ex)
-                                                        {
-                                                            Label = {};
-                                                            Mnemonic = {};
-                                                            OpCode = {};
-                                                            Operands = {};
-                                                        }
-                                                        if(!Label.empty())
+                                                        if(Current->LineType == SourceLine::LineTypeEnum::LINE_CONTROL
+                                                                && Current->Control == PreProcessorControlEnum::PP_LINE
+                                                                && Current->MarkerLine.has_value()
+                                                                && CurrentFile != Current->MarkerFile)
+                                                            throw AssemblyException("Macro definition must be within a single source file", AssemblyErrorSeverity::SEVERITY_Error);
+
+                                                        // Lines that fail to tokenise are carried into the expansion untouched
+                                                        if(!Current->Label.empty())
                                                             throw AssemblyException("Cannot define a label inside a macro", AssemblyErrorSeverity::SEVERITY_Error);
-                                                        if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
+                                                        if(Current->OpCode.has_value() && Current->OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
+                                                        {
+                                                            Start->BodyEnd = Source.Index();
+                                                            Start->BodyEndLineNumber = LineNumber;
+                                                            Start->BodyEndFile = CurrentFile;
                                                             break;
-                                                        fmt::println(Expansion, OriginalLine);
+                                                        }
+                                                        MacroDefinition.Compile(Current->Text);
                                                     }
-
-                                                    MacroDefinition.Expansion = Expansion.str();
                                                     break;
                                                 }
                                                 case OpCodeEnum::ENDMACRO:
@@ -313,189 +340,61 @@ bool Assembler::Run()
                                                     break;
                                                 case OpCodeEnum::MACROEXPANSION:
                                                 {
-                                                    std::string MacroExpansion;
+                                                    const Macro* Definition = nullptr;
                                                     auto MacroDefinition = CurrentTable->Macros.find(Mnemonic);
                                                     if(MacroDefinition != CurrentTable->Macros.end())
-                                                        ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
+                                                        Definition = &MacroDefinition->second;
                                                     else if(CurrentTable != &MainTable)
                                                     {
                                                         MacroDefinition = MainTable.Macros.find(Mnemonic);
                                                         if(MacroDefinition != MainTable.Macros.end())
-                                                            ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
+                                                            Definition = &MacroDefinition->second;
                                                     }
-                                                    if(!MacroExpansion.empty())
-                                                        Source.InsertMacro(Mnemonic, MacroExpansion);
-                                                    else
+                                                    if(Definition == nullptr)
                                                         throw AssemblyException("Unknown OpCode", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    break;
-                                                }
-                                                case OpCodeEnum::DB:
-                                                {
-                                                    for(auto& Operand : Operands)
-                                                        switch(Operand[0])
-                                                        {
-                                                            case '\"':
-                                                            {
-                                                                std::vector<std::uint8_t> Data;
-                                                                StringToByteVector(Operand, Data);
-                                                                SubroutineSize += Data.size();
-                                                                break;
-                                                            }
-                                                            case '@':
-                                                            {
-                                                                std::string FileName = GetFileName(&Operand[1]);
-                                                                if(!fs::exists(FileName))
-                                                                    throw AssemblyException(fmt::format("File Not Found: '{Filename}'", fmt::arg("FileName", FileName)), AssemblyErrorSeverity::SEVERITY_Error);
-                                                                SubroutineSize += fs::file_size(FileName);
-                                                                break;
-                                                            }
-                                                            default:
-                                                            {
-                                                                SubroutineSize++;
-                                                                break;
-                                                            }
-                                                        }
-                                                    break;
-                                                }
-                                                case OpCodeEnum::DW:
-                                                {
-                                                    SubroutineSize += Operands.size() * 2;
-                                                    break;
-                                                }
-                                                case OpCodeEnum::DL:
-                                                {
-                                                    SubroutineSize += Operands.size() * 4;
+                                                    if(Definition->Arguments.size() != Operands.size())
+                                                        throw AssemblyException(fmt::format("Incorrect number of arguments passed to macro. Received {In}, Expected {Out}", fmt::arg("In", Operands.size()), fmt::arg("Out", Definition->Arguments.size())), AssemblyErrorSeverity::SEVERITY_Error);
+                                                    if(Definition->LineCount() == 0)
+                                                        throw AssemblyException("Unknown OpCode", AssemblyErrorSeverity::SEVERITY_Error);
+                                                    Source.InsertMacro(Mnemonic, *Definition, Operands);
                                                     break;
                                                 }
                                                 case OpCodeEnum::DQ:
-                                                {
                                                     if(sizeof(long) < 8)
                                                         throw AssemblyException("DQ Not supported in this build", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    SubroutineSize += Operands.size() * 8;
                                                     break;
-                                                }
                                                 case OpCodeEnum::RB:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() > 1)
-                                                        throw AssemblyException("RB takes one optional argument {count}", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    SubroutineSize += Count;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RW:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() > 1)
-                                                        throw AssemblyException("RW takes one optional argument {count}", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    SubroutineSize += Count * 2;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RL:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() > 1)
-                                                        throw AssemblyException("RL takes one optional argument {count}", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    SubroutineSize += Count * 4;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RQ:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() > 1)
-                                                        throw AssemblyException("RQ takes one optional argument {count}", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    SubroutineSize += Count * 8;
+                                                    if(Operands.size() > 1)
+                                                        throw AssemblyException(fmt::format("{OpCode} takes one optional argument {{count}}", fmt::arg("OpCode", Mnemonic)), AssemblyErrorSeverity::SEVERITY_Error);
                                                     break;
-                                                }
                                                 case OpCodeEnum::END:
                                                     if(InSub)
                                                         throw AssemblyException("END cannot appear inside a SUBROUTINE", AssemblyErrorSeverity::SEVERITY_Error);
                                                     if(Operands.size() != 1)
                                                         throw AssemblyException("END requires a single argument <entry point>", AssemblyErrorSeverity::SEVERITY_Error);
-                                                    while(Source.getLine(OriginalLine))
+                                                    while(Source.getLine(Current))
                                                         ;
                                                     break;
                                                 default:
                                                     break;
                                             }
                                         }
-                                        else
-                                        {
-                                            if(OpCode.value().CPUType > Processor)
-                                                throw AssemblyException("Instruction not supported on selected processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                            SubroutineSize += OpCodeTable::OpCodeBytes.at(OpCode->OpCodeType);
-                                        }
+                                        else if(OpCode.value().CPUType > Processor)
+                                            throw AssemblyException("Instruction not supported on selected processor", AssemblyErrorSeverity::SEVERITY_Error);
                                     }
                                     break;
                                 }
                                 case 2: // Generate Symbol Tables
                                 {
-                                    if(!Label.empty() && UnReferencedSubs.count(Label)==0 && (!OpCode.has_value() || OpCode.value().OpCode != OpCodeEnum::MACRO))
+                                    if(!Label.empty() && UnReferencedSubs.count(Label)==0 && (!OpCode.has_value() || (OpCode.value().OpCode != OpCodeEnum::MACRO && OpCode.value().OpCode != OpCodeEnum::EQU)))
                                     {
-                                        if(CurrentTable->Symbols.find(Label) == CurrentTable->Symbols.end())
-                                            CurrentTable->Symbols[Label].Value = ProgramCounter;
-                                        else
-                                        {
-                                            auto& Symbol = CurrentTable->Symbols[Label];
-                                            if(Symbol.Value.has_value())
-                                                throw AssemblyException(fmt::format("Label '{Label}' is already defined", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error);
-                                            Symbol.Value = ProgramCounter;
-                                        }
+                                        auto& Symbol = CurrentTable->Symbol(LabelId);
+                                        if(Symbol.Value.has_value())
+                                            throw AssemblyException(fmt::format("Label '{Label}' is already defined", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error);
+                                        Symbol.Value = ProgramCounter;
                                     }
 
                                     if(OpCode)
@@ -511,13 +410,22 @@ bool Assembler::Run()
                                                     if(Operands.size() != 1)
                                                         throw AssemblyException("EQU Requires a single argument <value>", AssemblyErrorSeverity::SEVERITY_Error);
 
+                                                    auto& Symbol = CurrentTable->Symbol(LabelId);
+                                                    if(Symbol.Value.has_value() || Symbol.Deferred)
+                                                        throw AssemblyException(fmt::format("Label '{Label}' is already defined", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error);
                                                     try
                                                     {
-                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                         if(CurrentTable != &MainTable)
                                                             E.AddLocalSymbols(CurrentTable);
-                                                        long Value = E.Evaluate(Operands[0]);
-                                                        CurrentTable->Symbols[Label].Value = Value;
+                                                        ExpressionResult Result = E.TryEvaluate(Operands[0]);
+                                                        if(Result.Value.has_value())
+                                                            Symbol.Value = Result.Value;
+                                                        else // Evaluated when first used, once the symbols it refers to are defined
+                                                        {
+                                                            Symbol.Deferred = std::make_shared<DeferredValue>(DeferredValue{ Operands[0], ProgramCounter, Processor, CurrentTable != &MainTable ? CurrentTable : nullptr });
+                                                            DeferredEqus.push_back({ CurrentTable, LabelId, Current, Source.Location(CurrentFile, LineNumber) });
+                                                        }
                                                     }
                                                     catch (ExpressionException Ex)
                                                     {
@@ -529,51 +437,39 @@ bool Assembler::Run()
                                                 {
                                                     if(UnReferencedSubs.count(Label) > 0) // Skip assembly if previously flagged as unreferenced and non-static
                                                     {
-                                                        while(Source.getLine(OriginalLine))
+                                                        if(Current->BodyEnd.has_value())
                                                         {
-                                                            LineNumber++;
-                                                            std::string Line = Trim(OriginalLine);
-                                                            if(Line.size()>0)
+                                                            LineNumber = Current->BodyEndLineNumber;
+                                                            CurrentFile = Current->BodyEndFile;
+                                                            Source.SkipTo(Current->BodyEnd.value(), Current);
+                                                        }
+                                                        else
+                                                            while(Source.getLine(Current))
                                                             {
-                                                                // Check for Pre-Processor Control statement (#control expression...)
-                                                                std::smatch MatchResult;
-                                                                if(regex_match(Line, MatchResult, std::regex(R"-(^#(\w+)(\s+(.*))?$)-")))
+                                                                LineNumber++;
+                                                                if(!Current->Lexed)
+                                                                    Lex(*Current);
+                                                                if(Current->Trimmed.size()>0)
                                                                 {
-                                                                    std::string ControlWord = MatchResult[1];
-                                                                    std::string Expression = MatchResult[3];
-                                                                    if(PreProcessorControlLookup.find(ControlWord) != PreProcessorControlLookup.end())
+                                                                    // Check for Pre-Processor Control statement (#control expression...)
+                                                                    if(Current->LineType == SourceLine::LineTypeEnum::LINE_CONTROL)
                                                                     {
-                                                                        switch(PreProcessorControlLookup.at(ControlWord))
+                                                                        if(Current->Control == PreProcessorControlEnum::PP_LINE)
                                                                         {
-                                                                            case PreProcessorControlEnum::PP_LINE:
-                                                                            {
-                                                                                std::smatch MatchResult;
-                                                                                std::string NewFile;
-                                                                                if(regex_match(Expression, MatchResult, std::regex(R"-(^"(.*)" ([0-9]+)$)-")))
-                                                                                {
-                                                                                    CurrentFile = MatchResult[1];
-                                                                                    LineNumber = stoi(MatchResult[2]);
-                                                                                }
-                                                                                else
-                                                                                    throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                                                                break;
-                                                                            }
-                                                                            default:
-                                                                                break;
+                                                                            if(!Current->MarkerLine.has_value())
+                                                                                throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
+                                                                            CurrentFile = Current->MarkerFile;
+                                                                            LineNumber = Current->MarkerLine.value();
                                                                         }
                                                                     }
-                                                                }
-                                                                else
-                                                                {
-                                                                    std::string Label;
-                                                                    std::string Mnemonic;
-                                                                    std::vector<std::string>Operands;
-                                                                    std::optional<OpCodeSpec> OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
-                                                                    if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDSUB)
-                                                                        break;
+                                                                    else if(Current->LineType == SourceLine::LineTypeEnum::LINE_STATEMENT)
+                                                                    {
+                                                                        const std::optional<OpCodeSpec>& OpCode = ExpandTokens(*Current);
+                                                                        if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDSUB)
+                                                                            break;
+                                                                    }
                                                                 }
                                                             }
-                                                        }
                                                     }
                                                     else // Assemble subroutine
                                                     {
@@ -598,17 +494,18 @@ bool Assembler::Run()
                                                                         long Align;
                                                                         if(SubOptions[1] == "AUTO")
                                                                         {
-                                                                            if(((ProgramCounter + CurrentTable->CodeSize) & 0xFF00) == (ProgramCounter & 0xFF00))
+                                                                            int Size = CurrentTable->CodeSize.value_or(0);
+                                                                            if(((ProgramCounter + Size) & 0xFF00) == (ProgramCounter & 0xFF00))
                                                                                 Align = 0;
                                                                             else
-                                                                                Align = AlignFromSize(CurrentTable->CodeSize);
+                                                                                Align = AlignFromSize(Size);
                                                                             InAutoAlignedSub = true;
                                                                         }
                                                                         else if(!SetAlignFromKeyword(SubOptions[1], Align))
                                                                         {
                                                                             try
                                                                             {
-                                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                                                 Align = E.Evaluate(SubOptions[1]);
                                                                                 if(Align != 2 && Align != 4 && Align != 8 && Align != 16 && Align != 32 && Align != 64 && Align != 128 && Align !=256)
                                                                                     throw AssemblyException("SUBROUTINE ALIGN must be 2,4,8,16,32,64,128,256 or AUTO", AssemblyErrorSeverity::SEVERITY_Error);
@@ -619,7 +516,7 @@ bool Assembler::Run()
                                                                             }
                                                                         }
                                                                         ProgramCounter = ProgramCounter + GetAlignExtraBytes(ProgramCounter, Align);
-                                                                        MainTable.Symbols[Label].Value = ProgramCounter;
+                                                                        MainTable.Symbol(LabelId).Value = ProgramCounter;
                                                                     }
                                                                     break;
 
@@ -637,13 +534,22 @@ bool Assembler::Run()
                                                                     break;
                                                             }
                                                         }
-                                                        CurrentTable->Symbols[Label].Value = ProgramCounter;
+                                                        CurrentTable->Symbol(LabelId).Value = ProgramCounter;
+                                                        SubAddress = ProgramCounter;
                                                         break;
                                                     }
                                                     break;
                                                 }
                                                 case OpCodeEnum::ENDSUB:
                                                 {
+                                                    // Measure a SUBROUTINE that Pass 1 could not size. An AUTO alignment chosen
+                                                    // for a different size has to be laid out again.
+                                                    const int Size = static_cast<uint16_t>(ProgramCounter - SubAddress);
+                                                    if(InAutoAlignedSub ? CurrentTable->CodeSize != Size : !CurrentTable->CodeSize.has_value())
+                                                    {
+                                                        LayoutChanged = LayoutChanged || InAutoAlignedSub;
+                                                        CurrentTable->CodeSize = Size;
+                                                    }
                                                     InAutoAlignedSub = false;
                                                     switch(Operands.size())
                                                     {
@@ -652,10 +558,9 @@ bool Assembler::Run()
                                                         case 1:
                                                             try
                                                             {
-                                                                AssemblyExpressionEvaluator E(*CurrentTable, ProgramCounter, Processor);
+                                                                AssemblyExpressionEvaluator E(*CurrentTable, ProgramCounter, Processor, &Expressions);
                                                                 long EntryPoint = E.Evaluate(Operands[0]);
-                                                                MainTable.Symbols[CurrentTable->Name].Value = EntryPoint;
-                                                                //CurrentTable->Symbols[CurrentTable->Name].Value = EntryPoint;
+                                                                MainTable.Symbol(SymbolNames::Id(CurrentTable->Name)).Value = EntryPoint;
                                                                 break;
                                                             }
                                                             catch (ExpressionException Ex)
@@ -671,42 +576,26 @@ bool Assembler::Run()
                                                 }
                                                 case OpCodeEnum::MACRO:
                                                 {
-                                                    while(Source.getLine(OriginalLine))
+                                                    if(Current->BodyEnd.has_value())
+                                                    {
+                                                        LineNumber = Current->BodyEndLineNumber;
+                                                        CurrentFile = Current->BodyEndFile;
+                                                        Source.SkipTo(Current->BodyEnd.value(), Current);
+                                                        break;
+                                                    }
+                                                    while(Source.getLine(Current))
                                                     {
                                                         LineNumber++;
-                                                        std::string Line = Trim(OriginalLine);
-                                                        try
-                                                        {
-                                                            OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
-                                                        }
-                                                        catch(AssemblyException Ex)
-                                                        {
-                                                            Label = {};
-                                                            Mnemonic = {};
-                                                            OpCode = {};
-                                                            Operands = {};
-                                                        }
-                                                        if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
+                                                        if(!Current->Lexed)
+                                                            Lex(*Current);
+                                                        if(Current->OpCode.has_value() && Current->OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
                                                             break;
                                                     }
                                                     break;
                                                 }
                                                 case OpCodeEnum::MACROEXPANSION:
                                                 {
-                                                    std::string MacroExpansion;
-                                                    auto MacroDefinition = CurrentTable->Macros.find(Mnemonic);
-                                                    if(MacroDefinition != CurrentTable->Macros.end())
-                                                        ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
-                                                    else if(CurrentTable != &MainTable)
-                                                    {
-                                                        MacroDefinition = MainTable.Macros.find(Mnemonic);
-                                                        if(MacroDefinition != MainTable.Macros.end())
-                                                            ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
-                                                    }
-                                                    if(!MacroExpansion.empty())
-                                                        Source.InsertMacro(Mnemonic, MacroExpansion);
-                                                    else
-                                                        throw AssemblyException("Unknown OpCode", AssemblyErrorSeverity::SEVERITY_Error);
+                                                    // The expansion recorded in pass 1 follows this line
                                                     break;
                                                 }
                                                 case OpCodeEnum::ORG:
@@ -717,7 +606,7 @@ bool Assembler::Run()
                                                         throw AssemblyException("ORG Requires a single argument <address>", AssemblyErrorSeverity::SEVERITY_Error);
                                                     try
                                                     {
-                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                         long x = E.Evaluate(Operands[0]);
                                                         if(x >= 0 && x < 0x10000)
                                                             ProgramCounter = x;
@@ -729,127 +618,35 @@ bool Assembler::Run()
                                                         throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                     }
                                                     if(!Label.empty())
-                                                        CurrentTable->Symbols[Label].Value = ProgramCounter;
+                                                        CurrentTable->Symbol(LabelId).Value = ProgramCounter;
 
                                                     break;
                                                 }
                                                 case OpCodeEnum::DB:
-                                                {
-                                                    for(auto& Operand : Operands)
-                                                        switch(Operand[0])
-                                                        {
-                                                            case '\"':
-                                                            {
-                                                                std::vector<std::uint8_t> Data;
-                                                                StringToByteVector(Operand, Data);
-                                                                ProgramCounter += Data.size();
-                                                                break;
-                                                            }
-                                                            case '@':
-                                                            {
-                                                                std::string FileName = GetFileName(&Operand[1]);
-                                                                ProgramCounter += fs::file_size(FileName);
-                                                                break;
-                                                            }
-                                                            default:
-                                                                ProgramCounter++;
-                                                                break;
-                                                        }
-                                                    break;
-                                                }
                                                 case OpCodeEnum::DW:
-                                                {
-                                                    ProgramCounter += Operands.size() * 2;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::DL:
-                                                {
-                                                    ProgramCounter += Operands.size() * 4;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::DQ:
-                                                {
-                                                    ProgramCounter += Operands.size() * 8;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RB:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    ProgramCounter += Count;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RW:
+                                                case OpCodeEnum::RL:
+                                                case OpCodeEnum::RQ:
                                                 {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
+                                                    if(Current->Size.has_value())
                                                     {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
+                                                        ProgramCounter += Current->Size.value();
+                                                        break;
                                                     }
-                                                    ProgramCounter += Count * 2;
-                                                    break;
-                                                }
-                                                case OpCodeEnum::RL:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
+                                                    try // Count refers to symbols
                                                     {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
+                                                        if(CurrentTable != &MainTable)
+                                                            E.AddLocalSymbols(CurrentTable);
+                                                        ProgramCounter += E.Evaluate(Operands[0]) * ReserveUnit(OpCode.value().OpCode);
                                                     }
-                                                    ProgramCounter += Count * 4;
-                                                    break;
-                                                }
-                                                case OpCodeEnum::RQ:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
+                                                    catch (ExpressionException Ex)
                                                     {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
+                                                        throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                     }
-                                                    ProgramCounter += Count * 8;
                                                     break;
                                                 }
                                                 case OpCodeEnum::ALIGN:
@@ -863,7 +660,7 @@ bool Assembler::Run()
                                                         long Align;
                                                         if(!SetAlignFromKeyword(Operands[0], Align))
                                                         {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                             if(CurrentTable != &MainTable)
                                                                 E.AddLocalSymbols(CurrentTable);
                                                             Align = E.Evaluate(Operands[0]);
@@ -878,23 +675,25 @@ bool Assembler::Run()
                                                     }
 
                                                     if(!Label.empty())
-                                                        CurrentTable->Symbols[Label].Value = ProgramCounter;
+                                                        CurrentTable->Symbol(LabelId).Value = ProgramCounter;
                                                     break;
                                                 }
                                                 case OpCodeEnum::END:
-                                                    while(Source.getLine(OriginalLine))
+                                                    while(Source.getLine(Current))
                                                         ;
                                                 default:
                                                     break;
                                             }
                                         }
-                                        else if(OpCode && OpCode.value().OpCodeType != OpCodeTypeEnum::PSEUDO_OP)
-                                            ProgramCounter += OpCodeTable::OpCodeBytes.at(OpCode->OpCodeType);
+                                        else
+                                            ProgramCounter += Current->Size.value();
                                     }
                                     break;
                                 }
                                 case 3: // Generate Code
                                 {
+                                    Image.SetSource(CodeSources.size());
+                                    CodeSources.push_back({ Current, Source.Location(CurrentFile, LineNumber) });
                                     if(OpCode)
                                     {
                                         if(OpCode.value().OpCodeType == OpCodeTypeEnum::PSEUDO_OP)
@@ -902,59 +701,50 @@ bool Assembler::Run()
                                             switch(OpCode.value().OpCode)
                                             {
                                                 case OpCodeEnum::EQU:
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     break;
                                                 case OpCodeEnum::SUB:
                                                 {
                                                     if(UnReferencedSubs.count(Label) > 0) // Skip assembly if previously flagged as unreferenced and non-static
                                                     {
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                        while(Source.getLine(OriginalLine))
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                                        if(!ListingFile.Enabled && Current->BodyEnd.has_value())
                                                         {
-                                                            LineNumber++;
-                                                            std::string Line = Trim(OriginalLine);
-                                                            if(Line.size()>0)
+                                                            LineNumber = Current->BodyEndLineNumber;
+                                                            CurrentFile = Current->BodyEndFile;
+                                                            Source.SkipTo(Current->BodyEnd.value(), Current);
+                                                        }
+                                                        else
+                                                        {
+                                                            bool Counted = true;
+                                                            while(Source.getLine(Current))
                                                             {
-                                                                // Check for Pre-Processor Control statement (#control expression...)
-                                                                std::smatch MatchResult;
-                                                                if(regex_match(Line, MatchResult, std::regex(R"-(^#(\w+)(\s+(.*))?$)-")))
+                                                                if(Counted)
+                                                                    LineNumber++;
+                                                                Counted = !Source.InMacro();
+                                                                if(Source.InMacro())
+                                                                    continue; // Macro expansions recorded in pass 1 aren't listed for a removed subroutine
+                                                                if(!Current->Lexed)
+                                                                    Lex(*Current);
+                                                                if(Current->Trimmed.size()>0)
                                                                 {
-                                                                    std::string ControlWord = MatchResult[1];
-                                                                    std::string Expression = MatchResult[3];
-                                                                    if(PreProcessorControlLookup.find(ControlWord) != PreProcessorControlLookup.end())
+                                                                    // Check for Pre-Processor Control statement (#control expression...)
+                                                                    if(Current->LineType == SourceLine::LineTypeEnum::LINE_CONTROL && Current->Control == PreProcessorControlEnum::PP_LINE)
                                                                     {
-                                                                        switch(PreProcessorControlLookup.at(ControlWord))
-                                                                        {
-                                                                            case PreProcessorControlEnum::PP_LINE:
-                                                                            {
-                                                                                std::smatch MatchResult;
-                                                                                std::string NewFile;
-                                                                                if(regex_match(Expression, MatchResult, std::regex(R"-(^"(.*)" ([0-9]+)$)-")))
-                                                                                {
-                                                                                    CurrentFile = MatchResult[1];
-                                                                                    LineNumber = stoi(MatchResult[2]) - 1;
-                                                                                }
-                                                                                else
-                                                                                    throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
-                                                                                break;
-                                                                            }
-                                                                            default:
-                                                                                ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                                                break;
-                                                                        }
+                                                                        if(!Current->MarkerLine.has_value())
+                                                                            throw AssemblyException("Bad line directive received from Pre-Processor", AssemblyErrorSeverity::SEVERITY_Error);
+                                                                        CurrentFile = Current->MarkerFile;
+                                                                        LineNumber = Current->MarkerLine.value() - 1;
+                                                                    }
+                                                                    else if(Current->LineType == SourceLine::LineTypeEnum::LINE_STATEMENT)
+                                                                    {
+                                                                        const std::optional<OpCodeSpec>& OpCode = ExpandTokens(*Current);
+                                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                                                        if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDSUB)
+                                                                            break;
                                                                     }
                                                                     else
-                                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                                }
-                                                                else
-                                                                {
-                                                                    std::string Label;
-                                                                    std::string Mnemonic;
-                                                                    std::vector<std::string>Operands;
-                                                                    std::optional<OpCodeSpec> OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
-                                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                                    if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDSUB)
-                                                                        break;
+                                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                                 }
                                                             }
                                                         }
@@ -981,14 +771,15 @@ bool Assembler::Run()
                                                                     case SubroutineOptionsEnum::SUBOPT_ALIGN:
                                                                         if(SubOptions[1] == "AUTO")
                                                                         {
-                                                                            if(((ProgramCounter + CurrentTable->CodeSize) & 0xFF00) == (ProgramCounter & 0xFF00))
+                                                                            int Size = CurrentTable->CodeSize.value_or(0);
+                                                                            if(((ProgramCounter + Size) & 0xFF00) == (ProgramCounter & 0xFF00))
                                                                                 Align = 0;
                                                                             else
-                                                                                Align = AlignFromSize(CurrentTable->CodeSize);
+                                                                                Align = AlignFromSize(Size);
                                                                         }
                                                                         else if(!SetAlignFromKeyword(SubOptions[1], Align))
                                                                         {
-                                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                                             Align = E.Evaluate(SubOptions[1]);
                                                                         }
 
@@ -1005,7 +796,7 @@ bool Assembler::Run()
                                                                                 break;
                                                                             case 2:
                                                                             {
-                                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                                                 if(CurrentTable != &MainTable)
                                                                                     E.AddLocalSymbols(CurrentTable);
                                                                                 PadByte = E.Evaluate(SubOptions[1]);
@@ -1030,72 +821,53 @@ bool Assembler::Run()
                                                             int BytesToAdd = GetAlignExtraBytes(ProgramCounter, Align);
                                                             if(Pad)
                                                                 for(int i = 0; i < BytesToAdd; i++)
-                                                                    CurrentCode->second.push_back(PadByte);
-                                                            else
-                                                                CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter + GetAlignExtraBytes(ProgramCounter, Align), {})).first;
+                                                                    Image.Write(ProgramCounter + i, PadByte);
                                                             ProgramCounter = ProgramCounter + BytesToAdd;
                                                             TotalPadBytes += BytesToAdd;
                                                         }
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     }
                                                     break;
                                                 }
                                                 case OpCodeEnum::ENDSUB:
                                                 {
                                                     CurrentTable = &MainTable;
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     break;
                                                 }
                                                 case OpCodeEnum::MACRO:
                                                 {
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                    while(Source.getLine(OriginalLine))
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                                    if(!ListingFile.Enabled && Current->BodyEnd.has_value())
                                                     {
-                                                        LineNumber++;
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                        std::string Line = Trim(OriginalLine);
-                                                        try
-                                                        {
-                                                            OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
-                                                        }
-                                                        catch(AssemblyException Ex)
-                                                        {
-                                                            Label = {};
-                                                            Mnemonic = {};
-                                                            OpCode = {};
-                                                            Operands = {};
-                                                        }
-                                                        if(OpCode.has_value() && OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
-                                                            break;
+                                                        LineNumber = Current->BodyEndLineNumber;
+                                                        CurrentFile = Current->BodyEndFile;
+                                                        Source.SkipTo(Current->BodyEnd.value(), Current);
+                                                        break;
                                                     }
-                                                    break;
-                                                }
-                                                case OpCodeEnum::MACROEXPANSION:
-                                                {
-                                                    std::string MacroExpansion;
-                                                    auto MacroDefinition = CurrentTable->Macros.find(Mnemonic);
-                                                    if(MacroDefinition != CurrentTable->Macros.end())
-                                                        ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
-                                                    else if(CurrentTable != &MainTable)
+                                                    while(Source.getLine(Current))
                                                     {
-                                                        MacroDefinition = MainTable.Macros.find(Mnemonic);
-                                                        if(MacroDefinition != MainTable.Macros.end())
-                                                            ExpandMacro(MacroDefinition->second, Operands, MacroExpansion);
-                                                    }
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                    if(!MacroExpansion.empty())
-                                                        Source.InsertMacro(Mnemonic, MacroExpansion);
-                                                    else
-                                                        throw AssemblyException("Unknown OpCode", AssemblyErrorSeverity::SEVERITY_Error);
+                                                        LineNumber++;
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                                        if(!Current->Lexed)
+                                                            Lex(*Current);
+                                                        if(Current->OpCode.has_value() && Current->OpCode.value().OpCode == OpCodeEnum::ENDMACRO)
+                                                            break;
+                                                    }
+                                                    break;
+                                                }
+                                                case OpCodeEnum::MACROEXPANSION:
+                                                {
+                                                    // The expansion recorded in pass 1 follows this line
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     break;
                                                 }
                                                 case OpCodeEnum::ORG:
                                                     try
                                                     {
-                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                         ProgramCounter = E.Evaluate(Operands[0]);
-                                                        CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     }
                                                     catch(ExpressionException Ex)
                                                     {
@@ -1105,7 +877,7 @@ bool Assembler::Run()
                                                 case OpCodeEnum::DB:
                                                 {
                                                     std::vector<std::uint8_t> Data;
-                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                     if(CurrentTable != &MainTable)
                                                         E.AddLocalSymbols(CurrentTable);
                                                     for(auto& Operand : Operands)
@@ -1137,15 +909,15 @@ bool Assembler::Run()
                                                                 }
                                                                 break;
                                                         }
-                                                    CurrentCode->second.insert(CurrentCode->second.end(), Data.begin(), Data.end());
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
+                                                    Image.Write(ProgramCounter, Data);
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data);
                                                     ProgramCounter += Data.size();
                                                     break;
                                                 }
                                                 case OpCodeEnum::DW:
                                                 {
                                                     std::vector<std::uint8_t> Data;
-                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                     if(CurrentTable != &MainTable)
                                                         E.AddLocalSymbols(CurrentTable);
                                                     for(auto& Operand : Operands)
@@ -1159,15 +931,15 @@ bool Assembler::Run()
                                                         {
                                                             throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                         }
-                                                    CurrentCode->second.insert(CurrentCode->second.end(), Data.begin(), Data.end());
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
+                                                    Image.Write(ProgramCounter, Data);
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data);
                                                     ProgramCounter += Data.size();
                                                     break;
                                                 }
                                                 case OpCodeEnum::DL:
                                                 {
                                                     std::vector<std::uint8_t> Data;
-                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                     if(CurrentTable != &MainTable)
                                                         E.AddLocalSymbols(CurrentTable);
                                                     for(auto& Operand : Operands)
@@ -1183,15 +955,15 @@ bool Assembler::Run()
                                                         {
                                                             throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                         }
-                                                    CurrentCode->second.insert(CurrentCode->second.end(), Data.begin(), Data.end());
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
+                                                    Image.Write(ProgramCounter, Data);
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data);
                                                     ProgramCounter += Data.size();
                                                     break;
                                                 }
                                                 case OpCodeEnum::DQ:
                                                 {
                                                     std::vector<std::uint8_t> Data;
-                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                    AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                     if(CurrentTable != &MainTable)
                                                         E.AddLocalSymbols(CurrentTable);
                                                     for(auto& Operand : Operands)
@@ -1211,97 +983,31 @@ bool Assembler::Run()
                                                         {
                                                             throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                         }
-                                                    CurrentCode->second.insert(CurrentCode->second.end(), Data.begin(), Data.end());
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
+                                                    Image.Write(ProgramCounter, Data);
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data);
                                                     ProgramCounter += Data.size();
                                                     break;
                                                 }
                                                 case OpCodeEnum::RB:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, {});
-                                                    ProgramCounter += Count;
-                                                    CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RW:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, {});
-                                                    ProgramCounter += Count * 2;
-                                                    CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RL:
-                                                {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
-                                                        {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
-                                                            if(CurrentTable != &MainTable)
-                                                                E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
-                                                        }
-                                                        catch (ExpressionException Ex)
-                                                        {
-                                                            throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
-                                                        }
-                                                    }
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, {});
-                                                    ProgramCounter += Count * 4;
-                                                    CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
-                                                    break;
-                                                }
                                                 case OpCodeEnum::RQ:
                                                 {
-                                                    long Count = 1;
-                                                    if (Operands.size() == 1)
-                                                    {
-                                                        try
+                                                    long Size = Current->Size.value_or(0);
+                                                    if(!Current->Size.has_value())
+                                                        try // Count refers to symbols
                                                         {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                             if(CurrentTable != &MainTable)
                                                                 E.AddLocalSymbols(CurrentTable);
-                                                            Count = E.Evaluate((Operands[0]));
+                                                            Size = E.Evaluate(Operands[0]) * ReserveUnit(OpCode.value().OpCode);
                                                         }
                                                         catch (ExpressionException Ex)
                                                         {
                                                             throw AssemblyException(Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
                                                         }
-                                                    }
-                                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, {});
-                                                    ProgramCounter += Count * 8;
-                                                    CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
+                                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, {});
+                                                    ProgramCounter += Size;
                                                     break;
                                                 }
                                                 case OpCodeEnum::ALIGN:
@@ -1310,7 +1016,7 @@ bool Assembler::Run()
                                                         long Align;
                                                         if(!SetAlignFromKeyword(Operands[0], Align))
                                                         {
-                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                            AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                             if(CurrentTable != &MainTable)
                                                                 E.AddLocalSymbols(CurrentTable);
                                                             Align = E.Evaluate(Operands[0]);
@@ -1325,7 +1031,7 @@ bool Assembler::Run()
                                                             ToUpper(SubOptions[0]);
                                                             if(SubOptions[0] == "PAD")
                                                             {
-                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                                 if(CurrentTable != &MainTable)
                                                                     E.AddLocalSymbols(CurrentTable);
                                                                 PadByte = E.Evaluate(SubOptions[1]);
@@ -1335,11 +1041,9 @@ bool Assembler::Run()
                                                         int ExtraBytes = GetAlignExtraBytes(Align, ProgramCounter);
                                                         if(Pad)
                                                             for(int i = 0; i < GetAlignExtraBytes(ProgramCounter, Align); i++)
-                                                                CurrentCode->second.push_back(PadByte);
-                                                        else
-                                                            CurrentCode = Code.insert(std::pair<uint16_t, std::vector<uint8_t>>(ProgramCounter, {})).first;
+                                                                Image.Write(ProgramCounter + i, PadByte);
                                                         ProgramCounter = ProgramCounter + GetAlignExtraBytes(ProgramCounter, Align);
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                         break;
                                                     }
                                                     catch(ExpressionException Ex)
@@ -1352,7 +1056,7 @@ bool Assembler::Run()
                                                         throw AssemblyException("ASSERT Requires a single argument <expression>, and optionam <message>", AssemblyErrorSeverity::SEVERITY_Error);
                                                     try
                                                     {
-                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                         if(CurrentTable != &MainTable)
                                                             E.AddLocalSymbols(CurrentTable);
                                                         long Result = E.Evaluate(Operands[0]);
@@ -1363,7 +1067,7 @@ bool Assembler::Run()
                                                             else
                                                                 throw AssemblyException("ASSERT Failed", AssemblyErrorSeverity::SEVERITY_Error);
                                                         }
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     }
                                                     catch(ExpressionException Ex)
                                                     {
@@ -1374,11 +1078,11 @@ bool Assembler::Run()
                                                 case OpCodeEnum::END:
                                                     try
                                                     {
-                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                        AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                         EntryPoint = E.Evaluate(Operands[0]);
-                                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
-                                                        while(Source.getLine(OriginalLine))
-                                                            ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
+                                                        while(Source.getLine(Current))
+                                                            ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                                     }
                                                     catch(ExpressionException Ex)
                                                     {
@@ -1392,150 +1096,16 @@ bool Assembler::Run()
                                         else
                                             try
                                             {
-                                                std::vector<std::uint8_t> Data;
-                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor);
+                                                AssemblyExpressionEvaluator E(MainTable, ProgramCounter, Processor, &Expressions);
                                                 if(CurrentTable != &MainTable)
                                                     E.AddLocalSymbols(CurrentTable);
 
-                                                switch(OpCode->OpCodeType)
-                                                {
-                                                    case OpCodeTypeEnum::BASIC:
-                                                    {
-                                                        if(Operands.size() != 0)
-                                                            throw AssemblyException("Unexpected operand", AssemblyErrorSeverity::SEVERITY_Error);
-                                                        Data.push_back(OpCode->OpCode);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::REGISTER:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Expected single operand of type Register", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-
-                                                        long Register = E.Evaluate(Operands[0]);
-                                                        if(OpCode->OpCode == LDN) // Special Case - LDN R0 is overriden by IDL
-                                                        {
-                                                            if(Register < 1 || Register > 15)
-                                                                throw AssemblyException(fmt::format("Register out of range (Expected: $1-$F, got: ${value:X}))", fmt::arg("value", Register)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        }
-                                                        else
-                                                        {
-                                                            if(Register < 0 || Register > 15)
-                                                                throw AssemblyException(fmt::format("Register out of range (Expected: $0-$F, got: ${value:X}))", fmt::arg("value", Register)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        }
-                                                        Data.push_back(OpCode->OpCode | Register);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::IMMEDIATE:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Expected single operand of type Byte", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Byte = E.Evaluate(Operands[0]);
-                                                        if(Byte > 0xFF && Byte < 0xFF80)
-                                                            throw AssemblyException(fmt::format("Operand out of range (Expteced: $0-$FF, got: ${value:X})", fmt::arg("value", Byte)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode);
-                                                        Data.push_back(Byte & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::SHORT_BRANCH:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Short Branch expected single operand", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Address = E.Evaluate(Operands[0]);
-                                                        if(((ProgramCounter + 1) & 0xFF00) != (Address & 0xFF00))
-                                                            throw AssemblyException("Short Branch out of range", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode);
-                                                        Data.push_back(Address & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::LONG_BRANCH:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Long Branch expected single operand", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Address = E.Evaluate(Operands[0]);
-                                                        if(Address < 0 || Address > 0xFFFF)
-                                                            throw AssemblyException(fmt::format("Operand out of range (Expteced: $0-$FFFF, got: ${value:X})", fmt::arg("value", Address)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode);
-                                                        Data.push_back(Address >> 8);
-                                                        Data.push_back(Address & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::INPUT_OUTPUT:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Expected single operand of type Port", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-
-                                                        long Port = E.Evaluate(Operands[0]);
-                                                        if(Port == 0 || Port > 7)
-                                                            throw AssemblyException("Port out of range (1-7)", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode | Port);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::EXTENDED:
-                                                    {
-                                                        Data.push_back(OpCode->OpCode >> 8);
-                                                        Data.push_back(OpCode->OpCode & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::EXTENDED_REGISTER:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Expected single operand of type Register", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-
-                                                        long Register = E.Evaluate(Operands[0]);
-                                                        if(Register < 0 || Register > 15)
-                                                            throw AssemblyException("Register out of range (0-F)", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode >> 8);
-                                                        Data.push_back(OpCode->OpCode & 0xFF | Register);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::EXTENDED_IMMEDIATE:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Expected single operand of type Byte", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Byte = E.Evaluate(Operands[0]);
-                                                        if(Byte > 0xFF && Byte < 0xFF80)
-                                                            throw AssemblyException(fmt::format("Operand out of range (Expteced: $0-$FF, got :${value:X})", fmt::arg("value", Byte)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode >> 8);
-                                                        Data.push_back(OpCode->OpCode & 0xFF);
-                                                        Data.push_back(Byte & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::EXTENDED_SHORT_BRANCH:
-                                                    {
-                                                        if(Operands.size() != 1)
-                                                            throw AssemblyException("Short Branch expected single operand", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Address = E.Evaluate(Operands[0]);
-                                                        if(((ProgramCounter + 2) & 0xFF00) != (Address & 0xFF00))
-                                                            throw AssemblyException("Short Branch out of range", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode >> 8);
-                                                        Data.push_back(OpCode->OpCode & 0xFF);
-                                                        Data.push_back(Address & 0xFF);
-                                                        break;
-                                                    }
-                                                    case OpCodeTypeEnum::EXTENDED_REGISTER_IMMEDIATE16:
-                                                    {
-                                                        if(Operands.size() != 2)
-                                                            throw AssemblyException("Expected Register and Immediate operands", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Register = E.Evaluate(Operands[0]);
-                                                        if(Register > 15)
-                                                            throw AssemblyException("Register out of range (0-F)", AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        long Address = E.Evaluate(Operands[1]);
-                                                        if(Address < -32768 || Address > 0xFFFF)
-                                                            throw AssemblyException(fmt::format("Operand out of range (Expteced: $0-$FFFF, got :${value:X})", fmt::arg("value", Address)), AssemblyErrorSeverity::SEVERITY_Error, OpCode->OpCodeType);
-                                                        Data.push_back(OpCode->OpCode >> 8);
-                                                        Data.push_back(OpCode->OpCode & 0xFF | Register);
-                                                        Data.push_back(Address >> 8);
-                                                        Data.push_back(Address & 0xFF);
-                                                        break;
-                                                    }
-                                                    default:
-                                                        break;
-                                                }
-
-                                                CurrentCode->second.insert(CurrentCode->second.end(), Data.begin(), Data.end());
+                                                InstructionBytes Data;
+                                                int Size = EncodeInstruction(OpCode.value(), Operands, E, ProgramCounter, Data);
+                                                Image.Write(ProgramCounter, Data.data(), Size);
 
-                                                ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
-                                                ProgramCounter += OpCodeTable::OpCodeBytes.at(OpCode->OpCodeType);
+                                                ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data.data(), Size);
+                                                ProgramCounter += Size;
                                             }
                                             catch(ExpressionException Ex)
                                             {
@@ -1543,26 +1113,23 @@ bool Assembler::Run()
                                             }
                                     }
                                     else
-                                        ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                        ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                 }
                             }
                         }
                         catch (AssemblyException Ex)
                         {
-                            if(!Errors.Contains(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), Ex.what(), Ex.Severity, Source.InMacro()))
+                            SourceLocation Location = Source.Location(CurrentFile, LineNumber);
+                            if(!Errors.Contains(Location, Ex.what(), Ex.Severity))
                             {
-                                PrintError(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), Line, Ex.what(), Ex.Severity, Source.InMacro());
-                                Errors.Push(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), Line, Ex.what(), Ex.Severity, Source.InMacro());
+                                PrintError(Location, Line, Ex.what(), Ex.Severity);
+                                Errors.Push(Location, Line, Ex.what(), Ex.Severity);
                             }
                             if(Ex.SkipToOpCode.has_value())
                             {
-                                while(Source.getLine(OriginalLine))
+                                while(Source.getLine(Current))
                                 {
-                                    std::string Line = Trim(OriginalLine);
-                                    std::string Label;
-                                    std::string Mnemonic;
-                                    std::vector<std::string>Operands;
-                                    std::optional<OpCodeSpec> OpCode = ExpandTokens(Line, Label, Mnemonic, Operands);
+                                    const std::optional<OpCodeSpec>& OpCode = ExpandTokens(*Current);
                                     if(OpCode.has_value() && OpCode.value().OpCode == Ex.SkipToOpCode)
                                         break;
                                 }
@@ -1570,13 +1137,13 @@ bool Assembler::Run()
                             if (Pass == 3)
                             {
                                 if(Ex.BytesToSkip == 0)
-                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                                 else
                                 {
                                     std::vector<std::uint8_t> Data;
                                     for(int i = 0; i< Ex.BytesToSkip; i++)
                                         Data.push_back(0);
-                                    ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro(), ProgramCounter, Data);
+                                    ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text, ProgramCounter, Data);
                                 }
                             }
                             ProgramCounter += Ex.BytesToSkip;
@@ -1584,7 +1151,7 @@ bool Assembler::Run()
                     }
                     else // Empty line
                         if (Pass == 3)
-                            ListingFile.Append(CurrentFile, LineNumber, Source.StreamName(), Source.LineNumber(), OriginalLine, Source.InMacro());
+                            ListingFile.Append(Source.Location(CurrentFile, LineNumber), Current->Text);
                 }
                 if(!Source.InMacro())
                     LineNumber++;
@@ -1600,19 +1167,113 @@ bool Assembler::Run()
                         throw AssemblyException("#if Nesting Error or missing #endif", AssemblyErrorSeverity::SEVERITY_Warning);
                     break;
                 case 2:
+                {
+                    // Lay out again with the measured sizes of AUTO aligned SUBROUTINEs, until they
+                    // settle. Their sizes only change if they reserve space with symbolic counts.
+                    // Once errors are reported assembly stops, with the symbols of this layout.
+                    if(LayoutChanged && Errors.count(AssemblyErrorSeverity::SEVERITY_Error) == 0)
+                    {
+                        if(++LayoutPasses > 8)
+                            throw AssemblyException("Size of AUTO aligned SUBROUTINE does not settle", AssemblyErrorSeverity::SEVERITY_Error);
+                        fmt::println("SUBROUTINE size changed, Repeating Pass 2");
+                        ClearSymbols(MainTable, SubTables);
+                        Pass = 1;
+                        break;
+                    }
+
+                    // Evaluate the EQUs that have not yet been used, last first, so that a chain of
+                    // forward references is evaluated a link at a time. Repeat while that makes
+                    // progress, as the depth evaluated on demand is limited.
+                    for(bool Progress = true; Progress; )
+                    {
+                        Progress = false;
+                        for(auto Pending = DeferredEqus.rbegin(); Pending != DeferredEqus.rend(); Pending++)
+                        {
+                            const DeferredValue& Definition = *Pending->Table->Symbol(Pending->Label).Deferred;
+                            if(Definition.Value.has_value())
+                                continue;
+                            try
+                            {
+                                AssemblyExpressionEvaluator E(MainTable, Definition.ProgramCounter, Definition.Processor, &Expressions);
+                                if(Pending->Table != &MainTable)
+                                    E.AddLocalSymbols(Pending->Table);
+                                if(E.TryEvaluate(SymbolNames::Name(Pending->Label)).Value.has_value())
+                                    Progress = true;
+                            }
+                            catch(ExpressionException Ex)
+                            {
+                                // Reported below
+                            }
+                        }
+                    }
+
+                    // References to symbols that are never defined are reported on the EQU line,
+                    // and each circular definition once, on its first line.
+                    std::set<std::string> ReportedCycles;
+                    for(auto& Pending : DeferredEqus)
+                    {
+                        SymbolDefinition& Symbol = Pending.Table->Symbol(Pending.Label);
+                        if(ReportedCycles.count(Symbol.Deferred->Cycle) > 0)
+                            continue;
+                        try
+                        {
+                            AssemblyExpressionEvaluator E(MainTable, Symbol.Deferred->ProgramCounter, Symbol.Deferred->Processor, &Expressions);
+                            if(Pending.Table != &MainTable)
+                                E.AddLocalSymbols(Pending.Table);
+                            Symbol.Value = E.Evaluate(SymbolNames::Name(Pending.Label));
+                        }
+                        catch(ExpressionException Ex)
+                        {
+                            if(!Symbol.Deferred->Cycle.empty())
+                                ReportedCycles.insert(Symbol.Deferred->Cycle);
+                            const SourceLine& Line = *Pending.Line;
+                            if(!Errors.Contains(Pending.Location, Ex.what(), AssemblyErrorSeverity::SEVERITY_Error))
+                            {
+                                PrintError(Pending.Location, Line.Trimmed, Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
+                                Errors.Push(Pending.Location, Line.Trimmed, Ex.what(), AssemblyErrorSeverity::SEVERITY_Error);
+                            }
+                        }
+                    }
+                    for(auto& Pending : DeferredEqus)
+                        Pending.Table->Symbol(Pending.Label).Deferred.reset();
+
                     break;
+                }
                 case 3:
                 {
                     // Check for END statement
                     if(!EntryPoint.has_value())
                         throw AssemblyException("END Statement is missing", AssemblyErrorSeverity::SEVERITY_Warning);
 
-                    // Check for un-used non-static SUBROUTINEs and reset to Pass 2 if found
+                    // Check for SUBROUTINEs that cannot be reached from the main code or a STATIC
+                    // SUBROUTINE, through the references recorded as each was assembled. All of
+                    // them are removed at once, and assembly restarted from Pass 2.
 
                     if(Errors.count(AssemblyErrorSeverity::SEVERITY_Error) == 0)
                     {
+                        std::map<const SymbolTable*, std::vector<const SymbolTable*>> References;
+                        std::set<const SymbolTable*> Reachable = { &MainTable };
+                        std::vector<const SymbolTable*> Pending = { &MainTable };
+                        for(const auto& SubTable : SubTables)
+                        {
+                            auto Symbol = MainTable.Find(SymbolNames::Id(SubTable.first));
+                            if(Symbol != nullptr)
+                                for(auto Referrer : Symbol->ReferencedBy)
+                                    References[Referrer].push_back(&SubTable.second);
+                            if(SubTable.second.Static && Reachable.insert(&SubTable.second).second)
+                                Pending.push_back(&SubTable.second);
+                        }
+                        while(!Pending.empty())
+                        {
+                            const SymbolTable* Table = Pending.back();
+                            Pending.pop_back();
+                            for(auto Referenced : References[Table])
+                                if(Reachable.insert(Referenced).second)
+                                    Pending.push_back(Referenced);
+                        }
+
                         for(const auto& SubTable : SubTables)
-                            if(MainTable.Symbols[SubTable.first].RefCount == 0 && ! SubTable.second.Static)
+                            if(Reachable.count(&SubTable.second) == 0)
                             {
                                 UnReferencedSubs.insert(SubTable.first);
                                 Pass = 1;
@@ -1626,53 +1287,37 @@ bool Assembler::Run()
 
                             // Clear Sub Symbol Tables
                             for(auto T = SubTables.begin(); T != SubTables.end(); )
-                                if(MainTable.Symbols[T->first].RefCount == 0 && ! T->second.Static)
+                                if(Reachable.count(&T->second) == 0)
                                 {
-                                    TotelOptimisedBytes += T->second.CodeSize;
+                                    TotelOptimisedBytes += T->second.CodeSize.value_or(0);
                                     T = SubTables.erase(T);
                                 }
                                 else
                                     T++;
 
-                            // Clear Master Symbol Table (Except hidden symbols, i.e. R0-F & P1-7)
-                            for(auto it = MainTable.Symbols.begin(); it != MainTable.Symbols.end(); )
-                            {
-                                if(!it->second.HideFromSymbolTable)
-                                    it = MainTable.Symbols.erase(it);
-                                else
-                                    ++it;
-                            }
-
-                            for(auto& Table : SubTables)
-                                Table.second.Symbols.clear();
+                            // Clear Symbol Tables (Except hidden symbols, i.e. R0-F & P1-7)
+                            ClearSymbols(MainTable, SubTables);
 
                             //SubTables.clear();
 
-                            // Reset Listing File
+                            // Discard the lines listed by this pass
                             ListingFile.Reset();
                             break;
                         }
                     }
 
-                    // Check for overlapping code
-                    int Overlap = 0;
-                    for(auto &Code1 : Code)
-                    {
-                        uint16_t Start1 = Code1.first;
-
-                        for(auto &Code2 : Code)
+                    // Report each range of code written more than once
+                    if(Image.OverlappingBytes() > 0)
+                        for(auto& Overlap : Image.FindOverlaps())
                         {
-                            if(Code1 != Code2)
-                            {
-                                uint16_t Start2 = Code2.first;
-                                uint16_t End2 = Code2.first + Code2.second.size();
-                                if (Start1 >= Start2 && Start1 < End2)
-                                    Overlap++;
-                            }
+                            std::string Message = fmt::format("Code overlaps at ${Start:04X}-${End:04X}, written by {First} and {Second}",
+                                                              fmt::arg("Start", Overlap.Address),
+                                                              fmt::arg("End", Overlap.Address + Overlap.Size - 1),
+                                                              fmt::arg("First", CodeSourceName(CodeSources[Overlap.First])),
+                                                              fmt::arg("Second", CodeSourceName(CodeSources[Overlap.Second])));
+                            PrintError(Message, AssemblyErrorSeverity::SEVERITY_Warning);
+                            Errors.Push(Message, AssemblyErrorSeverity::SEVERITY_Warning);
                         }
-                    }
-                    if(Overlap > 0)
-                        throw AssemblyException("Code blocks overlap", AssemblyErrorSeverity::SEVERITY_Warning);
                     break;
                 }
             }
@@ -1687,6 +1332,8 @@ bool Assembler::Run()
 
     } // for(int Pass = 1; Pass <= 3 && Errors.count(SEVERITY_Error) == 0; Pass++)...
 
+    // Write the listing of the final pass, once all of its errors are known
+    ListingFile.Render();
     ListingFile.AppendGlobalErrors();
 
     if(DumpSymbols)
@@ -1736,7 +1383,7 @@ bool Assembler::Run()
                     break;
                 }
             }
-            Output->Write(Code, EntryPoint);
+            Output->Write(Image, EntryPoint);
             delete Output;
         }
     }
@@ -1744,6 +1391,89 @@ bool Assembler::Run()
     return TotalErrors == 0 && TotalWarnings == 0;
 }
 
+//!
+//! \brief Lex
+//! \param Line
+//!
+//! Classify a source line and split it into its tokens. The result is cached in the
+//! SourceLine so that each line is only lexed once, however many passes replay it.
+void Assembler::Lex(SourceLine& Line)
+{
+    Line.Trimmed = Trim(Line.Text);
+    Line.LineType = Line.Trimmed.empty() ? SourceLine::LineTypeEnum::LINE_EMPTY : SourceLine::LineTypeEnum::LINE_STATEMENT;
+
+    // Check for Pre-Processor Control statement (#control expression...)
+    const std::string& Text = Line.Trimmed;
+    if(Text.size() > 1 && Text[0] == '#')
+    {
+        std::size_t WordEnd = 1;
+        while(WordEnd < Text.size() && IsWordChar(Text[WordEnd]))
+            WordEnd++;
+        std::size_t ExpressionStart = WordEnd;
+        while(ExpressionStart < Text.size() && IsSpace(Text[ExpressionStart]))
+            ExpressionStart++;
+
+        if(WordEnd > 1 && (WordEnd == Text.size() || IsSpace(Text[WordEnd])) && Text.find_first_of("\r\n", ExpressionStart) == std::string::npos)
+        {
+            auto Control = PreProcessorControlLookup.find(Text.substr(1, WordEnd - 1));
+            Line.Expression = Text.substr(ExpressionStart);
+            if(Control != PreProcessorControlLookup.end())
+            {
+                Line.LineType = SourceLine::LineTypeEnum::LINE_CONTROL;
+                Line.Control = Control->second;
+                if(Line.Control == PreProcessorControlEnum::PP_LINE)
+                {
+                    // "FileName" LineNumber
+                    const std::string& Marker = Line.Expression;
+                    std::size_t Quote = Marker.rfind("\" ");
+                    if(Marker.size() > 0 && Marker[0] == '"' && Quote != std::string::npos && Quote > 0 && Quote + 2 < Marker.size()
+                            && std::all_of(Marker.begin() + Quote + 2, Marker.end(), [](char Ch) { return std::isdigit(static_cast<unsigned char>(Ch)); }))
+                    {
+                        Line.MarkerFile = SourceNames::Id(Marker.substr(1, Quote - 1));
+                        Line.MarkerLine = stoi(Marker.substr(Quote + 2));
+                    }
+                }
+                else
+                    ToUpper(Line.Expression);
+            }
+            else
+                Line.LineType = SourceLine::LineTypeEnum::LINE_DIRECTIVE;
+        }
+    }
+
+    // Tokenise every line; the macro definition and skip loops inspect lines of any type
+    try
+    {
+        Line.OpCode = ExpandTokens(Line.Trimmed, Line.Label, Line.Mnemonic, Line.Operands);
+        if(!Line.Label.empty())
+            Line.LabelId = SymbolNames::Id(Line.Label);
+    }
+    catch(AssemblyException Ex)
+    {
+        Line.Error = Ex;
+        Line.Label = {};
+        Line.Mnemonic = {};
+        Line.OpCode = {};
+        Line.Operands = {};
+    }
+    Line.Lexed = true;
+}
+
+//!
+//! \brief ExpandTokens
+//! \param Line
+//! \return
+//!
+//! Return the OpCode of a lexed source line, rethrowing any error found while lexing it.
+const std::optional<OpCodeSpec>& Assembler::ExpandTokens(SourceLine& Line)
+{
+    if(!Line.Lexed)
+        Lex(Line);
+    if(Line.Error.has_value())
+        throw Line.Error.value();
+    return Line.OpCode;
+}
+
 //!
 //! \brief ExpandTokens
 //! \param Line
@@ -1754,123 +1484,290 @@ bool Assembler::Run()
 //! Expand the source line into Label, OpCode, Operands
 const std::optional<OpCodeSpec> Assembler::ExpandTokens(const std::string& Line, std::string& Label, std::string& Mnemonic, std::vector<std::string>& OperandList)
 {
-    std::smatch MatchResult;
-    if(regex_match(Line, MatchResult, std::regex(R"(^(((\w+):?\s*)|\s+)((\w+)(\s+(.*))?)?$)"))) // Label{:} OpCode Operands
+    // Single scan of: {Label{:}} {whitespace} {Mnemonic {whitespace Operands}}
+    // A line without a label must start with whitespace.
+    const std::size_t End = Line.size();
+    std::size_t Pos = 0;
+    std::size_t LabelEnd = 0;
+    bool SpaceAfterLabel = false;
+
+    if(Pos < End && IsWordChar(Line[Pos]))
     {
-        // Extract Label, OpCode and Operands
-        std::string Operands;
-        Label = MatchResult[3];
-        ToUpper(Label);
-        if(!Label.empty() && !regex_match(Label, std::regex(R"(^[A-Z_][A-Z0-9_]*$)")))
-            throw AssemblyException(fmt::format("Invalid Label: '{Label}'", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error);
-        Mnemonic = MatchResult[5];
-
-        if(Mnemonic.length() == 0)
-            return {};
-        ToUpper(Mnemonic);
-
-        Operands = MatchResult[7];
+        while(Pos < End && IsWordChar(Line[Pos]))
+            Pos++;
+        LabelEnd = Pos;
+        if(Pos < End && Line[Pos] == ':')
+            Pos++;
+        else
+            SpaceAfterLabel = Pos < End && IsSpace(Line[Pos]);
+        while(Pos < End && IsSpace(Line[Pos]))
+            Pos++;
+    }
+    else
+    {
+        while(Pos < End && IsSpace(Line[Pos]))
+            Pos++;
+        if(Pos == 0)
+            throw AssemblyException("Unable to parse line", AssemblyErrorSeverity::SEVERITY_Error);
+    }
 
-        StringListToVector(Operands, OperandList, ',');
+    std::size_t MnemonicStart = Pos;
+    while(Pos < End && IsWordChar(Line[Pos]))
+        Pos++;
+    std::size_t MnemonicEnd = Pos;
+    std::size_t OperandStart = End;
 
-        OpCodeSpec OpCode;
-        try
+    if(Pos < End)
+    {
+        if(MnemonicEnd > MnemonicStart && IsSpace(Line[Pos]))
         {
-            OpCode = OpCodeTable::OpCode.at(Mnemonic);
+            while(Pos < End && IsSpace(Line[Pos]))
+                Pos++;
+            OperandStart = Pos;
         }
-        catch (std::out_of_range Ex)  // If Mnemonic wasn't found in the OpCode table, it's possibly a Macro so return MACROEXPANSION
+        else if(SpaceAfterLabel && LabelEnd > 1)
         {
-            OpCode = { MACROEXPANSION, OpCodeTypeEnum::PSEUDO_OP, CPUTypeEnum::CPU_1802 };
+            // A label directly followed by something other than a Mnemonic is read as a
+            // label, with its last character taken as the Mnemonic
+            MnemonicStart = LabelEnd - 1;
+            MnemonicEnd = LabelEnd;
+            LabelEnd--;
+            OperandStart = MnemonicEnd;
+            while(OperandStart < End && IsSpace(Line[OperandStart]))
+                OperandStart++;
         }
-        return OpCode;
+        else
+            throw AssemblyException("Unable to parse line", AssemblyErrorSeverity::SEVERITY_Error);
+
+        if(Line.find_first_of("\r\n", OperandStart) != std::string::npos)
+            throw AssemblyException("Unable to parse line", AssemblyErrorSeverity::SEVERITY_Error);
     }
-    else
-        throw AssemblyException("Unable to parse line", AssemblyErrorSeverity::SEVERITY_Error);
+
+    // Extract Label, OpCode and Operands
+    Label = Line.substr(0, LabelEnd);
+    ToUpper(Label);
+    if(!Label.empty() && std::isdigit(static_cast<unsigned char>(Label[0])))
+        throw AssemblyException(fmt::format("Invalid Label: '{Label}'", fmt::arg("Label", Label)), AssemblyErrorSeverity::SEVERITY_Error);
+    Mnemonic = Line.substr(MnemonicStart, MnemonicEnd - MnemonicStart);
+
+    if(Mnemonic.length() == 0)
+        return {};
+    ToUpper(Mnemonic);
+
+    StringListToVector(Line.substr(OperandStart), OperandList, ',');
+
+    auto OpCode = OpCodeTable::FindOpCode(Mnemonic);
+    if(OpCode)
+        return OpCode;
+
+    // If Mnemonic wasn't found in the OpCode table, it's possibly a Macro so return MACROEXPANSION
+    return OpCodeSpec { MACROEXPANSION, OpCodeTypeEnum::PSEUDO_OP, CPUTypeEnum::CPU_1802 };
 }
 
 //!
-//! \brief ExpandMacro
-//! Apply the Operands to the Macro Arguments, and return the Expanded string with the operands replaced.
-//! \param Definition
+//! \brief EncodeInstruction
+//! \param OpCode
 //! \param Operands
-//! \return
+//! \param E
+//! \param ProgramCounter
+//! \param Data
+//! \return Number of bytes written to Data
+//!
+//! Encode a machine instruction, as described by the OperandSpec for its type
 //!
-void Assembler::ExpandMacro(const Macro& Definition, const std::vector<std::string>& Operands, std::string& Output)
+int Assembler::EncodeInstruction(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands, AssemblyExpressionEvaluator& E, uint16_t ProgramCounter, InstructionBytes& Data)
 {
-    if(Definition.Arguments.size() != Operands.size())
-        throw AssemblyException(fmt::format("Incorrect number of arguments passed to macro. Received {In}, Expected {Out}", fmt::arg("In", Operands.size()), fmt::arg("Out", Definition.Arguments.size())), AssemblyErrorSeverity::SEVERITY_Error);
-
-    std::map<std::string, std::string> Parameters;
-    for(int i=0; i < Definition.Arguments.size(); i++)
-        Parameters[Definition.Arguments[i]] = Operands[i];
-
-    std::string Input = Definition.Expansion;
+    const OpCodeTable::OperandSpec& Spec = OpCodeTable::Operands(OpCode.OpCodeType);
+    if(Operands.size() != OpCodeTable::OperandCount(Spec.OperandType))
+        throw AssemblyException(Spec.CountError, AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
 
-    bool inSingleQuotes = false;
-    bool inDoubleQuotes = false;
-    bool inEscape = false;
+    int Size = 0;
+    if(Spec.OpCodeBytes == 2)
+        Data[Size++] = OpCode.OpCode >> 8;
+    uint8_t Code = OpCode.OpCode & 0xFF;
 
-    for(int i = 0; i < Input.size(); i++)
+    switch(Spec.OperandType)
     {
-        char ch = Input[i];
-
-        if(inEscape)
+        case OperandTypeEnum::NONE:
+            Data[Size++] = Code;
+            break;
+        case OperandTypeEnum::REGISTER:
+        case OperandTypeEnum::REGISTER_WORD:
         {
-            Output += ch;
-            inEscape = false;
+            long Register = E.Evaluate(Operands[0]);
+            long Lowest = (OpCode.OpCode == LDN) ? 1 : 0;  // Special Case - LDN R0 is overriden by IDL
+            if(Register < Lowest || Register > 15)
+                throw AssemblyException(fmt::format("Register out of range (Expected: ${Lowest:X}-$F, got: ${value:X})", fmt::arg("Lowest", Lowest), fmt::arg("value", Register)), AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+            Data[Size++] = Code | Register;
+            if(Spec.OperandType == OperandTypeEnum::REGISTER_WORD)
+            {
+                long Word = E.Evaluate(Operands[1]);
+                if(Word < -32768 || Word > 0xFFFF)
+                    throw AssemblyException(fmt::format("Operand out of range (Expected: $0-$FFFF, got: ${value:X})", fmt::arg("value", Word)), AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+                Data[Size++] = (Word >> 8) & 0xFF;
+                Data[Size++] = Word & 0xFF;
+            }
+            break;
         }
-        else if(inSingleQuotes)
+        case OperandTypeEnum::PORT:
         {
-            Output += ch;
-
-            if(ch == '\\')
-                inEscape = true;
-
-            if(inSingleQuotes && ch == '\'' && !inEscape)
-                inSingleQuotes = false;
+            long Port = E.Evaluate(Operands[0]);
+            if(Port < 1 || Port > 7)
+                throw AssemblyException("Port out of range (1-7)", AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+            Data[Size++] = Code | Port;
+            break;
         }
-        else if(inDoubleQuotes)
+        case OperandTypeEnum::BYTE:
         {
-            Output += ch;
-
-            if(ch == '\\')
-                inEscape = true;
-
-            if(inDoubleQuotes && ch == '\"' && !inEscape)
-                inDoubleQuotes = false;
+            long Byte = E.Evaluate(Operands[0]);
+            if(Byte > 0xFF && Byte < 0xFF80)
+                throw AssemblyException(fmt::format("Operand out of range (Expected: $0-$FF, got: ${value:X})", fmt::arg("value", Byte)), AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+            Data[Size++] = Code;
+            Data[Size++] = Byte & 0xFF;
+            break;
         }
-        else if(ch == '\'')
+        case OperandTypeEnum::SHORT_BRANCH:
         {
-            inSingleQuotes = true;
-            Output += ch;
+            long Address = E.Evaluate(Operands[0]);
+            if(((ProgramCounter + Size + 1) & 0xFF00) != (Address & 0xFF00))
+                throw AssemblyException("Short Branch out of range", AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+            Data[Size++] = Code;
+            Data[Size++] = Address & 0xFF;
+            break;
         }
-        else if(ch == '\"')
+        case OperandTypeEnum::ADDRESS:
         {
-            inDoubleQuotes = true;
-            Output += ch;
+            long Address = E.Evaluate(Operands[0]);
+            if(Address < 0 || Address > 0xFFFF)
+                throw AssemblyException(fmt::format("Operand out of range (Expected: $0-$FFFF, got: ${value:X})", fmt::arg("value", Address)), AssemblyErrorSeverity::SEVERITY_Error, OpCode.OpCodeType);
+            Data[Size++] = Code;
+            Data[Size++] = Address >> 8;
+            Data[Size++] = Address & 0xFF;
+            break;
         }
-        else
+    }
+    return Size;
+}
+
+//!
+//! \brief DataSize
+//! \param OpCode DB, DW, DL or DQ
+//! \param Operands
+//! \return The number of bytes generated, without evaluating any expressions
+//!
+std::size_t Assembler::DataSize(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands)
+{
+    switch(OpCode.OpCode)
+    {
+        case OpCodeEnum::DW:
+            return Operands.size() * 2;
+        case OpCodeEnum::DL:
+            return Operands.size() * 4;
+        case OpCodeEnum::DQ:
+            return Operands.size() * 8;
+        default:
         {
-            std::string Identifier;
-            int j = i;
-            while(isalnum(Input[j]) || Input[j]=='_')
-                Identifier += Input[j++];
-            if(Identifier.size() > 0)
-            {
-                std::string UCIdentifier(Identifier);
-                ToUpper(UCIdentifier);
-                if(Parameters.find(UCIdentifier) != Parameters.end())
-                    Output += Parameters[UCIdentifier];
-                else
-                    Output += Identifier;
-                i += Identifier.size() - 1;
-            }
-            else
-                Output += ch;
+            std::size_t Size = 0;
+            for(auto& Operand : Operands)
+                switch(Operand[0])
+                {
+                    case '\"':
+                    {
+                        std::vector<std::uint8_t> Data;
+                        StringToByteVector(Operand, Data);
+                        Size += Data.size();
+                        break;
+                    }
+                    case '@':
+                    {
+                        std::string FileName = GetFileName(&Operand[1]);
+                        if(!fs::exists(FileName))
+                            throw AssemblyException(fmt::format("File Not Found: '{FileName}'", fmt::arg("FileName", FileName)), AssemblyErrorSeverity::SEVERITY_Error);
+                        Size += fs::file_size(FileName);
+                        break;
+                    }
+                    default:
+                        Size++;
+                        break;
+                }
+            return Size;
+        }
+    }
+}
+
+//!
+//! \brief LineSize
+//! \param OpCode
+//! \param Operands
+//! \param E Evaluator for the count of RB, RW, RL or RQ
+//! \return Bytes generated or reserved by the line, if they are known without the symbols.
+//! ALIGN, ORG and SUBROUTINE alignment depend on the layout, and are not included.
+//!
+std::optional<long> Assembler::LineSize(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands, AssemblyExpressionEvaluator& E)
+{
+    if(OpCode.OpCodeType != OpCodeTypeEnum::PSEUDO_OP)
+        return OpCodeTable::OpCodeBytes(OpCode.OpCodeType);
+
+    switch(OpCode.OpCode)
+    {
+        case OpCodeEnum::DB:
+        case OpCodeEnum::DW:
+        case OpCodeEnum::DL:
+        case OpCodeEnum::DQ:
+            return DataSize(OpCode, Operands);
+        case OpCodeEnum::RB:
+        case OpCodeEnum::RW:
+        case OpCodeEnum::RL:
+        case OpCodeEnum::RQ:
+        {
+            if(Operands.empty())
+                return ReserveUnit(OpCode.OpCode);
+            std::optional<long> Count = E.ConstantValue(Operands[0]);
+            if(!Count.has_value())
+                return {};
+            return Count.value() * ReserveUnit(OpCode.OpCode);
         }
+        default:
+            return 0;
+    }
+}
+
+//!
+//! \brief ReserveUnit
+//! \param OpCode RB, RW, RL or RQ
+//! \return Size of each item reserved
+//!
+int Assembler::ReserveUnit(OpCodeEnum OpCode)
+{
+    switch(OpCode)
+    {
+        case OpCodeEnum::RW:
+            return 2;
+        case OpCodeEnum::RL:
+            return 4;
+        case OpCodeEnum::RQ:
+            return 8;
+        default:
+            return 1;
     }
 }
 
+//!
+//! \brief ClearSymbols
+//! \param MainTable
+//! \param SubTables
+//!
+//! Remove the symbols defined by a pass, ready for it to be repeated. Hidden symbols
+//! (i.e. R0-F & P1-7) are kept. The tables retire their entries by generation rather
+//! than erasing them.
+//!
+void Assembler::ClearSymbols(SymbolTable& MainTable, std::map<std::string, SymbolTable>& SubTables)
+{
+    MainTable.Clear();
+    for(auto& Table : SubTables)
+        Table.second.Clear();
+}
+
 //!
 //! \brief GetFileName
 //! Extract the filename component from an @"Filename" DB parameter
@@ -1879,9 +1776,9 @@ void Assembler::ExpandMacro(const Macro& Definition, const std::vector<std::stri
 //!
 std::string Assembler::GetFileName(std::string Operand)
 {
-    std::smatch MatchResult;
-    if(regex_match(Operand, MatchResult, std::regex(R"(^\"(.+)\"$)")))
-        return MatchResult[1];
+    // "FileName"
+    if(Operand.size() > 2 && Operand.front() == '"' && Operand.back() == '"' && Operand.find_first_of("\r\n") == std::string::npos)
+        return Operand.substr(1, Operand.size() - 2);
     else
         throw AssemblyException("Not Supported", AssemblyErrorSeverity::SEVERITY_Error);
 }
@@ -1970,7 +1867,7 @@ void Assembler::StringToByteVector(const std::string& Operand, std::vector<uint8
 //! \param Output
 //! \param Delimiter
 //!
-void Assembler::StringListToVector(std::string& Input, std::vector<std::string>& Output, char Delimiter)
+void Assembler::StringListToVector(const std::string& Input, std::vector<std::string>& Output, char Delimiter)
 {
     bool inSingleQuote = false;
     bool inDoubleQuote = false;
@@ -1991,7 +1888,8 @@ void Assembler::StringListToVector(std::string& Input, std::vector<std::string>&
         }
         if(!inSingleQuote && !inDoubleQuote && !inEscape && !inBrackets && ch == Delimiter)
         {
-            Output.push_back(regex_replace(out, std::regex(R"(\s+$)"), ""));
+            TrimRight(out);
+            Output.push_back(out);
             out="";
             SkipSpaces = true;
             continue;
@@ -2019,7 +1917,10 @@ void Assembler::StringListToVector(std::string& Input, std::vector<std::string>&
         out.push_back(ch);
     }
     if(out.size() > 0)
-        Output.push_back(regex_replace(out, std::regex(R"(\s+$)"), ""));
+    {
+        TrimRight(out);
+        Output.push_back(out);
+    }
 }
 
 //!
@@ -2085,27 +1986,26 @@ int Assembler::GetAlignExtraBytes(int ProgramCounter, int Align)
 
 //!
 //! \brief PrintError
-//! \param SourceFileName
-//! \param LineNumber
+//! \param Location
 //! \param Line
 //! \param Message
 //! \param Severity
 //!
 //! Print the error to StdErr
 //!
-void Assembler::PrintError(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const std::string& Message, const AssemblyErrorSeverity Severity, const bool InMacro)
+void Assembler::PrintError(const SourceLocation& Location, const std::string& Line, const std::string& Message, const AssemblyErrorSeverity Severity)
 {
     std::string FileRef;
     std::string LineRef;
-    if(InMacro)
+    if(Location.InMacro())
     {
-        FileRef = FileName+"::"+MacroName;
-        LineRef = fmt::format("{LineNumber:05}.{MacroLineNumber:02}", fmt::arg("LineNumber", LineNumber-1), fmt::arg("MacroLineNumber", MacroLineNumber));
+        FileRef = SourceNames::Name(Location.File)+"::"+SourceNames::Name(Location.Macro);
+        LineRef = fmt::format("{LineNumber:05}.{MacroLineNumber:02}", fmt::arg("LineNumber", Location.Line-1), fmt::arg("MacroLineNumber", Location.MacroLine));
     }
     else
     {
-        FileRef = FileName;
-        LineRef = fmt::format("{LineNumber:05}   ", fmt::arg("LineNumber", LineNumber));
+        FileRef = SourceNames::Name(Location.File);
+        LineRef = fmt::format("{LineNumber:05}   ", fmt::arg("LineNumber", Location.Line));
     }
 
     try // Source may not contain anything...
@@ -2139,3 +2039,23 @@ void Assembler::PrintError(const std::string& Message, AssemblyErrorSeverity Sev
                  fmt::arg("severity", " "+AssemblyException::SeverityName.at(Severity)),
                  fmt::arg("message", Message));
 }
+
+//!
+//! \brief CodeSourceName
+//! \param Source
+//! \return The file and line number of Source, with the macro line if it is within an expansion
+//!
+std::string Assembler::CodeSourceName(const CodeSource& Source)
+{
+    const SourceLocation& Location = Source.Location;
+    if(Location.InMacro())
+        return fmt::format("{File}:{LineNumber} ({Macro}:{MacroLineNumber})",
+                           fmt::arg("File", SourceNames::Name(Location.File)),
+                           fmt::arg("LineNumber", Location.Line - 1),
+                           fmt::arg("Macro", SourceNames::Name(Location.Macro)),
+                           fmt::arg("MacroLineNumber", Location.MacroLine));
+    else
+        return fmt::format("{File}:{LineNumber}",
+                           fmt::arg("File", SourceNames::Name(Location.File)),
+                           fmt::arg("LineNumber", Location.Line));
+}
@@ -1,6 +1,7 @@
 #ifndef ASSEMBLER_H
 #define ASSEMBLER_H
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <optional>
@@ -8,8 +9,14 @@
 #include <string>
 #include <vector>
 #include "assemblyexception.h"
+#include "compiledexpression.h"
 #include "macro.h"
 #include "opcodetable.h"
+#include "sourcelocation.h"
+
+class AssemblyExpressionEvaluator;
+class SourceLine;
+class SymbolTable;
 
 class Assembler
 {
@@ -40,27 +47,52 @@ public:
     };
     const static std::map<std::string, OutputFormatEnum> OutputFormatLookup;
 
-    Assembler(const std::string& FileName, CPUTypeEnum& InitialProcessor, bool ListingEnabled, bool DumpSymbols, bool& NoRegisters, bool& NoPorts, const std::vector<OutputFormatEnum>& BinMode);
+    Assembler(const std::string& FileName, const std::vector<std::string>& PreProcessedSource, CPUTypeEnum& InitialProcessor, bool ListingEnabled, bool DumpSymbols, bool& NoRegisters, bool& NoPorts, const std::vector<OutputFormatEnum>& BinMode);
     bool Run();
+    void Lex(SourceLine& Line);
 private:
+    typedef std::array<uint8_t, OpCodeTable::MaxOpCodeBytes> InstructionBytes;
+
+    struct CodeSource           // The line responsible for a write to the code image
+    {
+        const SourceLine* Line;
+        SourceLocation Location;
+    };
+
+    struct DeferredEqu          // An EQU of Pass 2 that refers to symbols defined further on
+    {
+        SymbolTable* Table;     // Table holding the symbol
+        SymbolId Label;
+        const SourceLine* Line;
+        SourceLocation Location;
+    };
+
     const std::string& FileName;
+    const std::vector<std::string>& PreProcessedSource;
     const CPUTypeEnum& InitialProcessor;
     bool ListingEnabled;
     bool DumpSymbols;
     const bool& NoRegisters;
     const bool& NoPorts;
     const std::vector<OutputFormatEnum>& BinMode;
+    ExpressionCache Expressions;    // Operand expressions compiled on first use, shared by every pass
 
+    const std::optional<OpCodeSpec>& ExpandTokens(SourceLine& Line);
     const std::optional<OpCodeSpec> ExpandTokens(const std::string& Line, std::string& Label, std::string& OpCode, std::vector<std::string>& Operands);
-    void ExpandMacro(const Macro& Definition, const std::vector<std::string>& Operands, std::string& Output);
+    int  EncodeInstruction(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands, AssemblyExpressionEvaluator& E, uint16_t ProgramCounter, InstructionBytes& Data);
+    std::size_t DataSize(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands);
+    std::optional<long> LineSize(const OpCodeSpec& OpCode, const std::vector<std::string>& Operands, AssemblyExpressionEvaluator& E);
+    int  ReserveUnit(OpCodeEnum OpCode);
+    void ClearSymbols(SymbolTable& MainTable, std::map<std::string, SymbolTable>& SubTables);
     std::string GetFileName(std::string Operand);
     void StringToByteVector(const std::string& Operand, std::vector<uint8_t>& Data);
-    void StringListToVector(std::string& Input, std::vector<std::string>& Output, char Delimiter);
+    void StringListToVector(const std::string& Input, std::vector<std::string>& Output, char Delimiter);
     int  AlignFromSize(int Size);
     bool SetAlignFromKeyword(std::string Alignment, long& Align);
     int  GetAlignExtraBytes(int ProgramCounter, int Align);
-    void PrintError(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const std::string& Message, const AssemblyErrorSeverity Severity, const bool InMacro);
+    void PrintError(const SourceLocation& Location, const std::string& Line, const std::string& Message, const AssemblyErrorSeverity Severity);
     void PrintError(const std::string& Message, AssemblyErrorSeverity Severity);
+    std::string CodeSourceName(const CodeSource& Source);
 };
 
 #endif // ASSEMBLER_H
@@ -11,7 +11,7 @@ AssemblyException::AssemblyException(const std::string& Message, AssemblyErrorSe
 {
     this->Message = Message;
     this->Severity = Severity;
-    this->BytesToSkip = OpCodeTable::OpCodeBytes.at(OpCodeType);
+    this->BytesToSkip = OpCodeTable::OpCodeBytes(OpCodeType);
 }
 
 AssemblyException::AssemblyException(const std::string& Message, AssemblyErrorSeverity Severity, OpCodeEnum SkipToOpCode)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "assemblyexpressionevaluator.h"
 #include "expressionexception.h"
 #include "utils.h"
@@ -12,11 +13,11 @@ const std::map<std::string, AssemblyExpressionEvaluator::FunctionSpec> AssemblyE
     { "ISNDEF",      { FunctionEnum::FN_ISNDEF,    1 }}
 };
 
-AssemblyExpressionEvaluator::AssemblyExpressionEvaluator(const SymbolTable& Global, uint16_t ProgramCounter, CPUTypeEnum Processor) :
-    ExpressionEvaluatorBase(),
+AssemblyExpressionEvaluator::AssemblyExpressionEvaluator(const SymbolTable& Global, uint16_t ProgramCounter, CPUTypeEnum Processor, ExpressionCache* Cache) :
+    ExpressionEvaluatorBase(Processor, Cache),
     Global(&Global),
     ProgramCounter(ProgramCounter),
-    Processor(Processor)
+    Resolving(&DeferredLabels)
 {
     LocalSymbols = false;
 }
@@ -32,93 +33,92 @@ void AssemblyExpressionEvaluator::AddLocalSymbols(const SymbolTable* Local)
     LocalSymbols = true;
 }
 
-long AssemblyExpressionEvaluator::AtomValue()
+//!
+//! \brief ExpressionEvaluator::CompileAtom
+//! Highest Precedence
+//! Constant / Label / Function Call / Bracketed Expression
+//!
+void AssemblyExpressionEvaluator::CompileAtom()
 {
-    long Result = 0;
-    auto Token = TokenStream.Get();
+    auto Token = TokenStream->Get();
     switch(Token)
     {
         case ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING:
             throw ExpressionException("Unexpected string literal");
             break;
         case ExpressionTokenizer::TokenEnum::TOKEN_NUMBER:
-            Result = TokenStream.IntegerValue;
+            Code.Emit(InstructionEnum::OP_PUSH_CONSTANT, TokenStream->IntegerValue);
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_DOLLAR:
         case ExpressionTokenizer::TokenEnum::TOKEN_DOT:
-            Result = ProgramCounter;
+            Code.Emit(InstructionEnum::OP_PUSH_PROGRAM_COUNTER);
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE: // Bracketed Expression
-            Result = EvaluateSubExpression();
-            if (TokenStream.Peek() != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+            CompileSubExpression();
+            if (TokenStream->Peek() != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                 throw ExpressionException("Expected ')'");
             else
-                TokenStream.Get();
+                TokenStream->Get();
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_LABEL:
         {
-            std::string Label = TokenStream.StringValue;
-            if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE)
+            std::string Label(TokenStream->StringValue);
+            if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE)
             {
-                TokenStream.Get();
+                TokenStream->Get();
 
                 auto FunctionSpec = FunctionTable.find(Label);
                 if(FunctionSpec == FunctionTable.end())
                     throw ExpressionException("Unknown function call");
 
-                std::vector<long> Arguments = { };
                 switch(FunctionSpec->second.ID)
                 {
                     case FunctionEnum::FN_PROCESSOR:
                     {
                         std::string Value;
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING)
-                            TokenStream.Get();
-                        else if(!TokenStream.GetCustomToken(std::regex(R"(^(([Cc][Dd][Pp])?180[2456][Aa]?).*)")))
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING)
+                            TokenStream->Get();
+                        else if(!TokenStream->GetProcessorDesignation())
                             throw ExpressionException("Expected Processor designation");
 
-                        Value = TokenStream.StringValue;
+                        Value = TokenStream->StringValue;
                         ToUpper(Value);
 
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                         {
-                            TokenStream.Get();
+                            TokenStream->Get();
 
-                            auto CPU = OpCodeTable::CPUTable.find(Value);
-                            if(CPU == OpCodeTable::CPUTable.end())
+                            auto CPU = OpCodeTable::FindCPU(Value);
+                            if(!CPU)
                                 throw ExpressionException("Unrecognised processor designation");
-                            Result = CPU->second <= Processor ? 1 : 0;
+                            Code.Emit(InstructionEnum::OP_PUSH_PROCESSOR, static_cast<long>(CPU.value()));
                         }
                         else
                             throw ExpressionException("Extra characters after Processor designation");
                         break;
                     }
                     case FunctionEnum::FN_LOW:
-                        if(!GetFunctionArguments(Arguments, FunctionSpec->second.Arguments))
+                        if(!GetFunctionArguments(FunctionSpec->second.Arguments))
                             throw ExpressionException("Incorrect number of arguments: LOW expects 1 argument");
-                        Result = Arguments[0] & 0xFF;
+                        Code.Emit(InstructionEnum::OP_LOW);
                         break;
                     case FunctionEnum::FN_HIGH:
-                        if(!GetFunctionArguments(Arguments, FunctionSpec->second.Arguments))
+                        if(!GetFunctionArguments(FunctionSpec->second.Arguments))
                             throw ExpressionException("Incorrect number of arguments: HIGH expects 1 argument");
-                        Result = (Arguments[0] >> 8) & 0xFF;
+                        Code.Emit(InstructionEnum::OP_HIGH);
                         break;
                     case FunctionEnum::FN_ISDEF:
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LABEL)
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LABEL)
                         {
-                            Result = 0;
-                            TokenStream.Get();
-                            std::string Label = TokenStream.StringValue;
-                            if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+                            TokenStream->Get();
+                            std::string Label(TokenStream->StringValue);
+                            if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                             {
-                                TokenStream.Get();
-                                if (LocalSymbols && Local->Symbols.find(Label) != Local->Symbols.end())
-                                    Result = 1;
-                                if (Global->Symbols.find(Label) != Global->Symbols.end())
-                                    Result = 1;
+                                TokenStream->Get();
+                                Code.EmitSymbol(InstructionEnum::OP_PUSH_DEFINED, Label);
                             }
                             else
                                 throw ExpressionException("')' Expected");
@@ -127,18 +127,14 @@ long AssemblyExpressionEvaluator::AtomValue()
                             throw ExpressionException("ISDEF expects a single LABEL argument");
                         break;
                     case FunctionEnum::FN_ISNDEF:
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LABEL)
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LABEL)
                         {
-                            Result = 1;
-                            TokenStream.Get();
-                            std::string Label = TokenStream.StringValue;
-                            if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+                            TokenStream->Get();
+                            std::string Label(TokenStream->StringValue);
+                            if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                             {
-                                TokenStream.Get();
-                                if (LocalSymbols && Local->Symbols.find(Label) != Local->Symbols.end())
-                                    Result = 0;
-                                if (Global->Symbols.find(Label) != Global->Symbols.end())
-                                    Result = 0;
+                                TokenStream->Get();
+                                Code.EmitSymbol(InstructionEnum::OP_PUSH_NOT_DEFINED, Label);
                             }
                             else
                                 throw ExpressionException("')' Expected");
@@ -149,49 +145,146 @@ long AssemblyExpressionEvaluator::AtomValue()
                 }
             }
             else
-                Result = SymbolValue(Label);
+                Code.EmitSymbol(InstructionEnum::OP_PUSH_SYMBOL, Label);
             break;
         }
         default: // Should never happen
             throw ExpressionException("Current Token Not Yet Implemented");
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SymbolValue
 //! Lookup the given Label in the local and global symbol tables
-//! Local Table takes precedence.
+//! Local Table takes precedence. A Label without a value is recorded as unresolved.
+//! Global symbols record the table of the code referring to them.
 //! \param Label
 //! \return
 //!
-long AssemblyExpressionEvaluator::SymbolValue(std::string Label)
+long AssemblyExpressionEvaluator::SymbolValue(SymbolId Label)
 {
     if(LocalSymbols)
     {
-        auto Symbol = Local->Symbols.find(Label);
-        if(Symbol != Local->Symbols.end())
+        const SymbolDefinition* Symbol = Local->Find(Label);
+        if(Symbol != nullptr)
         {
-            if(Symbol->second.Value.has_value())
+            if(Symbol->Value.has_value())
             {
-                Symbol->second.RefCount++;
-                return Symbol->second.Value.value();
+                return Symbol->Value.value();
             }
+            else if(Symbol->Deferred)
+                return DeferredSymbolValue(Label, *Symbol->Deferred);
             else
-                throw ExpressionException(fmt::format("Label '{Label}' is not yet assigned", fmt::arg("Label", Label)));
+            {
+                AddUnresolved(SymbolNames::Name(Label), fmt::format("Label '{Label}' is not yet assigned", fmt::arg("Label", SymbolNames::Name(Label))));
+                return 0;
+            }
         }
     }
 
-    auto Symbol = Global->Symbols.find(Label);
-    if(Symbol != Global->Symbols.end())
+    const SymbolDefinition* Symbol = Global->Find(Label);
+    if(Symbol != nullptr)
     {
-        if(Symbol->second.Value.has_value())
+        if(Symbol->Value.has_value())
         {
-            Symbol->second.RefCount++;
-            return Symbol->second.Value.value();
+            Symbol->ReferencedBy.insert(LocalSymbols ? Local : Global);
+            return Symbol->Value.value();
         }
+        else if(Symbol->Deferred)
+            return DeferredSymbolValue(Label, *Symbol->Deferred);
         else
-            throw ExpressionException(fmt::format("Label '{Label}' is not yet assigned", fmt::arg("Label", Label)));
+        {
+            AddUnresolved(SymbolNames::Name(Label), fmt::format("Label '{Label}' is not yet assigned", fmt::arg("Label", SymbolNames::Name(Label))));
+            return 0;
+        }
     }
-    throw ExpressionException(fmt::format("Label '{Label}' not found", fmt::arg("Label", Label)));
+    AddUnresolved(SymbolNames::Name(Label), fmt::format("Label '{Label}' not found", fmt::arg("Label", SymbolNames::Name(Label))));
+    return 0;
+}
+
+//!
+//! \brief ExpressionEvaluator::DeferredSymbolValue
+//! Evaluate an EQU that was left until its symbol is used. If it still refers to symbols
+//! without a value, they are recorded as unresolved here, and it is tried again on the
+//! next use. So is an EQU nested too deeply to evaluate here, so that long chains do not
+//! exhaust the stack. An EQU that depends on itself throws an ExpressionException naming
+//! the cycle.
+//! \param Label
+//! \param Definition
+//! \return
+//!
+long AssemblyExpressionEvaluator::DeferredSymbolValue(SymbolId Label, DeferredValue& Definition)
+{
+    if(Definition.Value.has_value())
+        return Definition.Value.value();
+
+    if(Definition.Resolving)
+    {
+        auto Start = std::find_if(Resolving->begin(), Resolving->end(), [&](const auto& Entry) { return Entry.second == &Definition; });
+        std::string Cycle;
+        for(auto Entry = Start; Entry != Resolving->end(); Entry++)
+            Cycle += SymbolNames::Name(Entry->first) + " -> ";
+        Cycle = fmt::format("Circular EQU definition: {Cycle}{Label}", fmt::arg("Cycle", Cycle), fmt::arg("Label", SymbolNames::Name(Label)));
+        for(auto Entry = Start; Entry != Resolving->end(); Entry++)
+            Entry->second->Cycle = Cycle;
+        throw ExpressionException(Cycle);
+    }
+
+    if(Resolving->size() >= MaxDeferredDepth)
+    {
+        AddUnresolved(SymbolNames::Name(Label), fmt::format("Label '{Label}' is not yet assigned", fmt::arg("Label", SymbolNames::Name(Label))));
+        return 0;
+    }
+
+    AssemblyExpressionEvaluator E(*Global, Definition.ProgramCounter, Definition.Processor, Cache);
+    if(Definition.Local != nullptr)
+        E.AddLocalSymbols(Definition.Local);
+    E.Resolving = Resolving;
+
+    ExpressionResult Result;
+    Definition.Resolving = true;
+    Resolving->emplace_back(Label, &Definition);
+    try
+    {
+        Result = E.TryEvaluate(Definition.Expression);
+    }
+    catch(ExpressionException Ex)
+    {
+        Definition.Resolving = false;
+        Resolving->pop_back();
+        throw;
+    }
+    Definition.Resolving = false;
+    Resolving->pop_back();
+
+    if(Result.Value.has_value())
+    {
+        Definition.Value = Result.Value;
+        return Result.Value.value();
+    }
+    for(auto& Symbol : E.Unresolved)
+        AddUnresolved(Symbol, E.UnresolvedMessage);
+    return 0;
+}
+
+//!
+//! \brief ExpressionEvaluator::SymbolDefined
+//! Check whether the given Label exists in the local or global symbol table
+//! \param Label
+//! \return
+//!
+bool AssemblyExpressionEvaluator::SymbolDefined(SymbolId Label)
+{
+    if (LocalSymbols && Local->Find(Label) != nullptr)
+        return true;
+    return Global->Find(Label) != nullptr;
+}
+
+//!
+//! \brief ExpressionEvaluator::ProgramCounterValue
+//! \return
+//!
+long AssemblyExpressionEvaluator::ProgramCounterValue()
+{
+    return ProgramCounter;
 }
@@ -3,6 +3,8 @@
 
 #include <fmt/core.h>
 #include <string>
+#include <utility>
+#include <vector>
 #include "opcodetable.h"
 #include "expressionevaluatorbase.h"
 #include "symboltable.h"
@@ -25,7 +27,7 @@ public:
         int Arguments;
     };
 
-    AssemblyExpressionEvaluator(const SymbolTable& Global, uint16_t ProgramCounter, CPUTypeEnum Processor);
+    AssemblyExpressionEvaluator(const SymbolTable& Global, uint16_t ProgramCounter, CPUTypeEnum Processor, ExpressionCache* Cache = nullptr);
     void AddLocalSymbols(const SymbolTable* Local);
 
 private:
@@ -33,10 +35,16 @@ private:
     const SymbolTable* Local;
     const SymbolTable* Global;
     bool LocalSymbols;      // Denotess if a local blob is available for symbol lookups
-    CPUTypeEnum Processor;
     const uint16_t ProgramCounter;
-    long SymbolValue(std::string Label);
-    long AtomValue();
+    static constexpr std::size_t MaxDeferredDepth = 256;   // EQUs nested deeper are left to the end of Pass 2
+    typedef std::vector<std::pair<SymbolId, DeferredValue*>> DeferredChain;
+    DeferredChain DeferredLabels;               // EQUs being evaluated, outermost first
+    DeferredChain* Resolving;                   // Shared with the evaluators of nested EQUs
+    void CompileAtom();
+    long SymbolValue(SymbolId Label);
+    long DeferredSymbolValue(SymbolId Label, DeferredValue& Definition);
+    bool SymbolDefined(SymbolId Label);
+    long ProgramCounterValue();
 };
 
 #endif // ASSEMBLYEXPRESSIONEVALUATOR_H
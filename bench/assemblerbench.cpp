@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fmt/core.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "assembler.h"
+#include "sourceline.h"
+
+//!
+//! \brief GenerateSource
+//! \param Blocks
+//! \param Source
+//!
+//! Pre-Processed source of Blocks STATIC subroutines, each of ten lines mixing labels,
+//! instructions, operand lists, comments and a blank line, as the lexer meets them in practice.
+//!
+static void GenerateSource(int Blocks, std::vector<std::string>& Source)
+{
+    Source.push_back("#line \"assemblerbench.asm\" 1");
+    for(int i = 0; i < Blocks; i++)
+    {
+        Source.push_back(fmt::format("Sub{:05} SUBROUTINE STATIC", i));
+        Source.push_back("Loop:   LDI     $12         ; Load the count");
+        Source.push_back("        PLO     R1");
+        Source.push_back("        DB      1, 2, \"AB\", $FF");
+        Source.push_back("        SEX     R2");
+        Source.push_back("        LBR     Loop");
+        Source.push_back("        ; Comment only");
+        Source.push_back("");
+        Source.push_back("        SEP     R5");
+        Source.push_back("        ENDSUB");
+    }
+    Source.push_back("Start   SUBROUTINE");
+    Source.push_back("        SEP     R5");
+    Source.push_back("        ENDSUB");
+    Source.push_back("        END     Start");
+}
+
+//!
+//! \brief main
+//! \param argc
+//! \param argv
+//! \return
+//!
+//! Lexer and assembler throughput, in source lines per second: assemblerbench {lines {repetitions}}
+//! The best of the repetitions is reported for each.
+//!
+int main(int argc, char **argv)
+{
+    const int MaxBlocks = 65536 / 13;  // Bytes generated by each block
+    int Lines = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int Repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    int Blocks = Lines / 10;
+    if(Blocks < 1 || Blocks > MaxBlocks || Repetitions < 1)
+    {
+        fmt::println("Usage: assemblerbench {{lines (10-{max})}} {{repetitions}}", fmt::arg("max", MaxBlocks * 10));
+        return 1;
+    }
+
+    std::vector<std::string> Source;
+    GenerateSource(Blocks, Source);
+    std::string FileName = "assemblerbench.asm";
+    CPUTypeEnum Processor = CPUTypeEnum::CPU_1802;
+    bool NoRegisters = false;
+    bool NoPorts = false;
+    std::vector<Assembler::OutputFormatEnum> OutputFormat;
+
+    // Lexing alone, over lines as Pass 1 records them
+    std::chrono::duration<double> BestLex = std::chrono::duration<double>::max();
+    for(int i = 0; i < Repetitions; i++)
+    {
+        Assembler Lexer(FileName, Source, Processor, false, false, NoRegisters, NoPorts, OutputFormat);
+        std::deque<SourceLine> Program;
+        for(auto& Text : Source)
+            Program.emplace_back(Text, SourceNames::None, 0);
+        auto Start = std::chrono::steady_clock::now();
+        for(auto& Line : Program)
+            Lexer.Lex(Line);
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+        if(Elapsed < BestLex)
+            BestLex = Elapsed;
+    }
+
+    // Complete assembly, silencing the progress reported by each run
+    std::fflush(stdout);
+    int Console = dup(STDOUT_FILENO);
+    if(!std::freopen("/dev/null", "w", stdout))
+        return 1;
+
+    bool Result = true;
+    std::chrono::duration<double> BestRun = std::chrono::duration<double>::max();
+    for(int i = 0; i < Repetitions && Result; i++)
+    {
+        auto Start = std::chrono::steady_clock::now();
+        Result = Assembler(FileName, Source, Processor, false, false, NoRegisters, NoPorts, OutputFormat).Run();
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+        if(Elapsed < BestRun)
+            BestRun = Elapsed;
+    }
+
+    std::fflush(stdout);
+    dup2(Console, STDOUT_FILENO);
+    close(Console);
+    if(!Result)
+    {
+        fmt::println("Assembly failed");
+        return 1;
+    }
+    fmt::println("{lines} lines, best of {count}", fmt::arg("lines", Source.size()), fmt::arg("count", Repetitions));
+    fmt::println("Lex:      {seconds:.4f}s, {rate:10.0f} lines/second", fmt::arg("seconds", BestLex.count()), fmt::arg("rate", Source.size() / BestLex.count()));
+    fmt::println("Assemble: {seconds:.4f}s, {rate:10.0f} lines/second", fmt::arg("seconds", BestRun.count()), fmt::arg("rate", Source.size() / BestRun.count()));
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "preprocessor.h"
+
+namespace fs = std::filesystem;
+
+//!
+//! \brief GenerateSource
+//! \param Blocks
+//! \param FileName
+//! \return Number of lines written
+//!
+//! Source of Blocks blocks, each of thirteen lines: statements and comments, with an
+//! #ifdef/#else/#endif and an #if 0 whose skipped lines are read past by SkipTo.
+//!
+static int GenerateSource(int Blocks, const std::string& FileName)
+{
+    std::ofstream Output(FileName);
+    fmt::println(Output, "#define COUNT 12");
+    fmt::println(Output, "#define PORT 3");
+    for(int i = 0; i < Blocks; i++)
+    {
+        fmt::println(Output, "#ifdef DEBUG");
+        fmt::println(Output, "        OUT     PORT        ; Skipped");
+        fmt::println(Output, "        DB      \"DEBUG\"");
+        fmt::println(Output, "#else");
+        fmt::println(Output, "Loop{:05}: LDI   COUNT       ; Load the count", i);
+        fmt::println(Output, "        PLO     R1");
+        fmt::println(Output, "#endif");
+        fmt::println(Output, "        SEX     R2");
+        fmt::println(Output, "        ; Comment only");
+        fmt::println(Output, "");
+        fmt::println(Output, "#if 0");
+        fmt::println(Output, "        SEP     R4");
+        fmt::println(Output, "#endif");
+    }
+    return Blocks * 13 + 2;
+}
+
+//!
+//! \brief main
+//! \param argc
+//! \param argv
+//! \return
+//!
+//! Pre-Processor throughput, in source lines per second: preprocessorbench {lines {repetitions}}
+//!
+int main(int argc, char **argv)
+{
+    int Lines = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int Repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    int Blocks = Lines / 13;
+    if(Blocks < 1 || Repetitions < 1)
+    {
+        fmt::println("Usage: preprocessorbench {{lines (13-)}} {{repetitions}}");
+        return 1;
+    }
+
+    std::string FileName = fs::temp_directory_path() / "preprocessorbench.asm";
+    Lines = GenerateSource(Blocks, FileName);
+
+    bool Result = true;
+    std::chrono::duration<double> Best = std::chrono::duration<double>::max();
+    for(int i = 0; i < Repetitions && Result; i++)
+    {
+        PreProcessor Source;
+        std::string OutputFile;
+        std::vector<std::string> OutputLines;
+        auto Start = std::chrono::steady_clock::now();
+        Result = Source.Run(FileName, OutputFile, OutputLines, false);
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+        if(Elapsed < Best)
+            Best = Elapsed;
+    }
+    fs::remove(FileName);
+
+    if(!Result)
+    {
+        fmt::println("Pre-Processing failed");
+        return 1;
+    }
+    fmt::println("{lines} lines, best of {count}: {seconds:.3f}s, {rate:.0f} lines/second",
+                 fmt::arg("lines", Lines), fmt::arg("count", Repetitions),
+                 fmt::arg("seconds", Best.count()), fmt::arg("rate", Lines / Best.count()));
+    return 0;
+}
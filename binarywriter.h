@@ -5,19 +5,19 @@
 #include <filesystem>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
-#include <map>
 #include <optional>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include "codeimage.h"
 
 namespace fs = std::filesystem;
 
 //!
 //! \brief The BinaryWriter class
 //! Abstrat base class for an output file writer.
-//! Inherit this, and implement void BinaryWriter_subcloass::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress)
+//! Inherit this, and implement void BinaryWriter_subcloass::Write(const CodeImage& Image, std::optional<uint16_t> StartAddress)
 //! See BinaryWriter_IntelHex for example
 class BinaryWriter
 {
@@ -25,7 +25,7 @@ public:
     BinaryWriter();
     BinaryWriter(const std::string& FileName, const std::string& Extension);
     virtual ~BinaryWriter();
-    virtual void Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress) = 0;
+    virtual void Write(const CodeImage& Image, std::optional<uint16_t> StartAddress) = 0;
 
 protected:
     std::string FileName;
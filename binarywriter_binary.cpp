@@ -5,24 +5,20 @@ BinaryWriter_Binary::BinaryWriter_Binary(const std::string& FileName, const std:
 {
 }
 
-void BinaryWriter_Binary::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress)
+void BinaryWriter_Binary::Write(const CodeImage& Image, std::optional<uint16_t> StartAddress)
 {
     std::optional<uint16_t> FirstBlock;
 
-    for(const auto& Blob : Code)
+    for(const auto& Segment : Image.Segments())
     {
-        const std::vector<uint8_t>& DataIn = Blob.second;
-        if(DataIn.size() > 0)
+        if(!FirstBlock.has_value())   // First Segment will have the lowest address, so should be used as the offset for all following segments
+            FirstBlock = Segment.Address;
+        else
         {
-            if(!FirstBlock.has_value())   // First Blob will have the lowest address, so should be used as the offset for all following blocks
-                FirstBlock = Blob.first;
-            else
-            {
-                int PadBytes = Blob.first - FirstBlock.value() - Output.tellp();
-                for(int i = 0; i < PadBytes; i++)
-                    Output.write("\0",1);
-            }
-            Output.write((const char *)&DataIn[0], DataIn.size());
+            int PadBytes = Segment.Address - FirstBlock.value() - Output.tellp();
+            for(int i = 0; i < PadBytes; i++)
+                Output.write("\0",1);
         }
+        Output.write((const char *)Segment.Data, Segment.Size);
     }
 }
@@ -4,7 +4,7 @@ BinaryWriter_ElfOS::BinaryWriter_ElfOS(const std::string& FileName, const std::s
 {
 }
 
-void BinaryWriter_ElfOS::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress)
+void BinaryWriter_ElfOS::Write(const CodeImage& Image, std::optional<uint16_t> StartAddress)
 {
     std::optional<uint16_t> FirstBlock;
 
@@ -16,14 +16,12 @@ void BinaryWriter_ElfOS::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, s
     if(StartAddress.has_value())
         ExecAddress = StartAddress.value();
 
-    for(const auto& Blob : Code)
-        if(Blob.second.size() > 0)
-        {
-            if(Blob.first < LoadAddress)
-                LoadAddress = Blob.first;
-            if(Blob.first + Blob.second.size() > EndAddress)
-                EndAddress = Blob.first + Blob.second.size();
-        }
+    std::vector<CodeImage::Segment> Segments = Image.Segments();
+    if(!Segments.empty())
+    {
+        LoadAddress = Segments.front().Address;
+        EndAddress = Segments.back().Address + Segments.back().Size;
+    }
     Size = EndAddress - LoadAddress;
 
     // Generate ElfOS header
@@ -37,20 +35,16 @@ void BinaryWriter_ElfOS::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, s
     Output.write((const char *)&Header[0], 6);
 
     // Write binary data
-    for(const auto& Blob : Code)
+    for(const auto& Segment : Segments)
     {
-        const std::vector<uint8_t>& DataIn = Blob.second;
-        if(DataIn.size() > 0)
+        if(!FirstBlock.has_value())   // First Segment will have the lowest address, so should be used as the offset for all following segments
+            FirstBlock = Segment.Address;
+        else
         {
-            if(!FirstBlock.has_value())   // First Blob will have the lowest address, so should be used as the offset for all following blocks
-                FirstBlock = Blob.first;
-            else
-            {
-                int PadBytes = Blob.first - FirstBlock.value() - Output.tellp() + Header.size();
-                for(int i = 0; i < PadBytes; i++)
-                    Output.write("\0",1);
-            }
-            Output.write((const char *)&DataIn[0], DataIn.size());
+            int PadBytes = Segment.Address - FirstBlock.value() - Output.tellp() + Header.size();
+            for(int i = 0; i < PadBytes; i++)
+                Output.write("\0",1);
         }
+        Output.write((const char *)Segment.Data, Segment.Size);
     }
 }
@@ -5,28 +5,25 @@ BinaryWriter_Idiot4::BinaryWriter_Idiot4(const std::string& FileName, const std:
 {
 }
 
-void BinaryWriter_Idiot4::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress)
+void BinaryWriter_Idiot4::Write(const CodeImage& Image, std::optional<uint16_t> StartAddress)
 {
     // Data Records
 
-    for(const auto& Blob : Code)
+    for(const auto& Segment : Image.Segments())
     {
-        uint16_t Address = Blob.first;
-        const std::vector<uint8_t>& DataIn = Blob.second;
-        if(DataIn.size() > 0)
+        uint16_t Address = Segment.Address;
+        const uint8_t* DataIn = Segment.Data;
+        for(int i = 0; i < Segment.Size / 16 + 1; i++)
         {
-            for(int i = 0; i < DataIn.size() / 16 + 1; i++)
+            int RecordSize = 0;
+            std::vector<uint8_t> DataBlock;
+            for(int j = 0; j < 16 && i * 16 + j < Segment.Size; j++)
             {
-                int RecordSize = 0;
-                std::vector<uint8_t> DataBlock;
-                for(int j = 0; j < 16 && i * 16 + j < DataIn.size(); j++)
-                {
-                    RecordSize ++;
-                    DataBlock.push_back(DataIn[i * 16 + j]);
-                }
-                if(DataBlock.size() > 0)
-                    fmt::println(Output, "!M{:04X} {:02X}", Address + i * 16, fmt::join(DataBlock, " "));
+                RecordSize ++;
+                DataBlock.push_back(DataIn[i * 16 + j]);
             }
+            if(DataBlock.size() > 0)
+                fmt::println(Output, "!M{:04X} {:02X}", Address + i * 16, fmt::join(DataBlock, " "));
         }
     }
 }
@@ -4,37 +4,34 @@ BinaryWriter_IntelHex::BinaryWriter_IntelHex(const std::string& FileName, const
 {
 }
 
-void BinaryWriter_IntelHex::Write(std::map<uint16_t, std::vector<uint8_t>>& Code, std::optional<uint16_t> StartAddress)
+void BinaryWriter_IntelHex::Write(const CodeImage& Image, std::optional<uint16_t> StartAddress)
 {
     // Data Records
 
-    for(const auto& Blob : Code)
+    for(const auto& Segment : Image.Segments())
     {
-        uint16_t Address = Blob.first;
-        const std::vector<uint8_t>& DataIn = Blob.second;
-        if(DataIn.size() > 0)
+        uint16_t Address = Segment.Address;
+        const uint8_t* DataIn = Segment.Data;
+        for(int i = 0; i < Segment.Size / 16 + 1; i++)
         {
-            for(int i = 0; i < DataIn.size() / 16 + 1; i++)
+            int RecordSize = 0;
+            std::vector<uint8_t> DataBlock =
             {
-                int RecordSize = 0;
-                std::vector<uint8_t> DataBlock =
-                {
-                    0,                                              // Byte Count (to be replaced)
-                    (uint8_t)(((Address + i * 16) & 0xFF00) >> 8),  // Address (Hi)
-                    (uint8_t)((Address + i * 16) & 0xFF),           // Address (Lo)
-                    0                                               // Record Type 0
-                };
+                0,                                              // Byte Count (to be replaced)
+                (uint8_t)(((Address + i * 16) & 0xFF00) >> 8),  // Address (Hi)
+                (uint8_t)((Address + i * 16) & 0xFF),           // Address (Lo)
+                0                                               // Record Type 0
+            };
 
-                for(int j = 0; j < 16 && i * 16 + j < DataIn.size(); j++)
-                {
-                    RecordSize ++;
-                    DataBlock.push_back(DataIn[i * 16 + j]);
-                }
-                DataBlock[0] = DataBlock.size() - 4;
-                AddCheckSum(DataBlock);
-                if(DataBlock.size() > 5)
-                    fmt::println(Output, ":{:02X}", fmt::join(DataBlock, ""));
+            for(int j = 0; j < 16 && i * 16 + j < Segment.Size; j++)
+            {
+                RecordSize ++;
+                DataBlock.push_back(DataIn[i * 16 + j]);
             }
+            DataBlock[0] = DataBlock.size() - 4;
+            AddCheckSum(DataBlock);
+            if(DataBlock.size() > 5)
+                fmt::println(Output, ":{:02X}", fmt::join(DataBlock, ""));
         }
     }
 
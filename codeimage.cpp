@@ -0,0 +1,132 @@
+#include <algorithm>
+#include "codeimage.h"
+
+CodeImage::CodeImage() :
+    Memory(SIZE, 0),
+    Written(SIZE / 64, 0)
+{
+}
+
+//!
+//! \brief CodeImage::Clear
+//!
+//! Mark every byte as unwritten, ready for the next pass
+//!
+void CodeImage::Clear()
+{
+    std::fill(Written.begin(), Written.end(), 0);
+    OverlapCount = 0;
+    Blocks.clear();
+    CurrentSource = 0;
+}
+
+//!
+//! \brief CodeImage::Write
+//! \param Address
+//! \param Data
+//! \param Size
+//!
+//! Store Size bytes from Address onwards, wrapping at the top of memory as the Program
+//! Counter does. Bytes that have already been written are counted as overlaps.
+//!
+void CodeImage::Write(uint16_t Address, const uint8_t* Data, std::size_t Size)
+{
+    if(Address + Size > SIZE)
+    {
+        AddBlock(Address, SIZE - Address);
+        AddBlock(0, Address + Size - SIZE);
+    }
+    else
+        AddBlock(Address, Size);
+
+    for(std::size_t i = 0; i < Size; i++, Address++)
+    {
+        uint64_t Bit = uint64_t(1) << (Address & 63);
+        uint64_t& Word = Written[Address >> 6];
+        if(Word & Bit)
+            OverlapCount++;
+        Word |= Bit;
+        Memory[Address] = Data[i];
+    }
+}
+
+//!
+//! \brief CodeImage::Segments
+//! \return The runs of written bytes, in address order
+//!
+std::vector<CodeImage::Segment> CodeImage::Segments() const
+{
+    std::vector<Segment> Result;
+    std::size_t Address = 0;
+    while(Address < SIZE)
+    {
+        // Step over unwritten bytes, a whole word at a time where possible
+        if((Address & 63) == 0 && Written[Address >> 6] == 0)
+        {
+            Address += 64;
+            continue;
+        }
+        if(!IsWritten(Address))
+        {
+            Address++;
+            continue;
+        }
+
+        std::size_t Start = Address;
+        while(Address < SIZE && IsWritten(Address))
+        {
+            if((Address & 63) == 0 && Written[Address >> 6] == ~uint64_t(0))
+                Address += 64;
+            else
+                Address++;
+        }
+        Result.push_back({ static_cast<uint16_t>(Start), Address - Start, &Memory[Start] });
+    }
+    return Result;
+}
+
+//!
+//! \brief CodeImage::FindOverlaps
+//! \return Each range written by two different Sources, in address order
+//!
+//! Sweep the Blocks in address order, keeping those that are still open. Each Block
+//! overlaps every open Block that ends after it starts.
+//!
+std::vector<CodeImage::Overlap> CodeImage::FindOverlaps() const
+{
+    std::vector<Overlap> Result;
+    std::vector<Block> Sorted(Blocks);
+    std::stable_sort(Sorted.begin(), Sorted.end(), [](const Block& lhs, const Block& rhs) { return lhs.Address < rhs.Address; });
+
+    std::vector<Block> Open;
+    for(auto& Current : Sorted)
+    {
+        Open.erase(std::remove_if(Open.begin(), Open.end(), [&Current](const Block& Entry) { return Entry.End <= Current.Address; }), Open.end());
+        for(auto& Entry : Open)
+        {
+            if(Entry.Source == Current.Source)
+                continue;
+            std::size_t End = std::min(Entry.End, Current.End);
+            Result.push_back({ static_cast<uint16_t>(Current.Address), End - Current.Address, std::min(Entry.Source, Current.Source), std::max(Entry.Source, Current.Source) });
+        }
+        Open.push_back(Current);
+    }
+    return Result;
+}
+
+//!
+//! \brief CodeImage::AddBlock
+//! \param Address
+//! \param Size
+//!
+//! Record a write, extending the previous Block where it simply continues it
+//!
+void CodeImage::AddBlock(std::size_t Address, std::size_t Size)
+{
+    if(Size == 0)
+        return;
+    if(!Blocks.empty() && Blocks.back().Source == CurrentSource && Blocks.back().End == Address)
+        Blocks.back().End += Size;
+    else
+        Blocks.push_back({ Address, Address + Size, CurrentSource });
+}
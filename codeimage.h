@@ -0,0 +1,82 @@
+#ifndef CODEIMAGE_H
+#define CODEIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//!
+//! \brief The CodeImage class
+//! The assembled output, held as a flat image of the 64K address space together with a
+//! bitmap of the bytes written. The contiguous runs of written bytes are presented to the
+//! BinaryWriters as a list of Segments, in address order.
+//! Each write is also recorded as a Block, tagged with the caller's Source, so that
+//! overlapping code can be traced back to the lines that produced it.
+//!
+class CodeImage
+{
+public:
+    static constexpr std::size_t SIZE = 0x10000;
+
+    struct Segment
+    {
+        uint16_t Address;
+        std::size_t Size;
+        const uint8_t* Data;    // Points into the image
+    };
+
+    struct Block
+    {
+        std::size_t Address;
+        std::size_t End;        // One past the last byte, at most SIZE
+        std::size_t Source;
+    };
+
+    struct Overlap
+    {
+        uint16_t Address;
+        std::size_t Size;
+        std::size_t First;      // Source of the earlier write
+        std::size_t Second;     // Source of the later write
+    };
+
+    CodeImage();
+    void Clear();
+    inline void SetSource(std::size_t Source)
+    {
+        CurrentSource = Source;
+    }
+    void Write(uint16_t Address, const uint8_t* Data, std::size_t Size);
+    inline void Write(uint16_t Address, const std::vector<uint8_t>& Data)
+    {
+        Write(Address, Data.data(), Data.size());
+    }
+    inline void Write(uint16_t Address, uint8_t Byte)
+    {
+        Write(Address, &Byte, 1);
+    }
+    inline bool IsWritten(uint16_t Address) const
+    {
+        return (Written[Address >> 6] >> (Address & 63)) & 1;
+    }
+    inline uint8_t operator[](uint16_t Address) const
+    {
+        return Memory[Address];
+    }
+    inline int OverlappingBytes() const
+    {
+        return OverlapCount;
+    }
+    std::vector<Segment> Segments() const;
+    std::vector<Overlap> FindOverlaps() const;
+
+private:
+    std::vector<uint8_t> Memory;
+    std::vector<uint64_t> Written;      // One bit per byte of Memory
+    int OverlapCount = 0;               // Bytes written more than once
+    std::vector<Block> Blocks;          // Every write, in the order made
+    std::size_t CurrentSource = 0;      // Tag for subsequent writes
+    void AddBlock(std::size_t Address, std::size_t Size);
+};
+
+#endif // CODEIMAGE_H
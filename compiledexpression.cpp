@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include "compiledexpression.h"
+#include "expressionexception.h"
+
+CompiledExpression::CompiledExpression()
+{
+}
+
+//!
+//! \brief CompiledExpression::Emit
+//! \param Op
+//! \param Operand
+//!
+//! Append an instruction. Unary and binary operations applied to constants are folded
+//! into a single constant, unless the operation fails, in which case the error is left
+//! to be reported when the expression is executed.
+//!
+void CompiledExpression::Emit(InstructionEnum Op, long Operand)
+{
+    auto Count = Code.size();
+    if(IsUnary(Op))
+    {
+        if(Count >= 1 && Code[Count - 1].Op == InstructionEnum::OP_PUSH_CONSTANT)
+        {
+            Code[Count - 1].Operand = Unary(Op, Code[Count - 1].Operand);
+            return;
+        }
+    }
+    else if(Op >= InstructionEnum::OP_LOGICAL_OR)
+    {
+        if(Count >= 2 && Code[Count - 2].Op == InstructionEnum::OP_PUSH_CONSTANT && Code[Count - 1].Op == InstructionEnum::OP_PUSH_CONSTANT)
+        {
+            try
+            {
+                Code[Count - 2].Operand = Binary(Op, Code[Count - 2].Operand, Code[Count - 1].Operand);
+                Code.pop_back();
+                return;
+            }
+            catch (ExpressionException Ex)
+            {
+                // Reported when executed, unless an unresolved symbol takes precedence
+            }
+        }
+    }
+    Code.push_back({ Op, Operand });
+}
+
+//!
+//! \brief CompiledExpression::EmitSymbol
+//! \param Op
+//! \param Symbol
+//!
+//! Append an instruction that refers to Symbol by its index in Symbols, which holds the
+//! interned ID of each symbol used
+//!
+void CompiledExpression::EmitSymbol(InstructionEnum Op, std::string_view Symbol)
+{
+    SymbolId Id = SymbolNames::Id(Symbol);
+    auto Entry = std::find(Symbols.begin(), Symbols.end(), Id);
+    if(Entry == Symbols.end())
+        Entry = Symbols.insert(Symbols.end(), Id);
+    Code.push_back({ Op, Entry - Symbols.begin() });
+}
+
+//!
+//! \brief CompiledExpression::IsUnary
+//! \param Op
+//! \return True if Op takes a single value from the stack
+//!
+bool CompiledExpression::IsUnary(InstructionEnum Op)
+{
+    return Op >= InstructionEnum::OP_NEGATE && Op <= InstructionEnum::OP_LOW;
+}
+
+//!
+//! \brief CompiledExpression::Unary
+//! \param Op
+//! \param Value
+//! \return
+//!
+long CompiledExpression::Unary(InstructionEnum Op, long Value)
+{
+    switch(Op)
+    {
+        case InstructionEnum::OP_NEGATE:
+            return -Value;
+        case InstructionEnum::OP_BITWISE_NOT:
+            return ~Value;
+        case InstructionEnum::OP_LOGICAL_NOT:
+            return Value ? 1 : 0;
+        case InstructionEnum::OP_HIGH:
+            return (Value >> 8) & 0xFF;
+        case InstructionEnum::OP_LOW:
+            return Value & 0xFF;
+        default: // Should never happen
+            throw ExpressionException("Unsupported operation in expression");
+    }
+}
+
+//!
+//! \brief CompiledExpression::Binary
+//! \param Op
+//! \param lhs
+//! \param rhs
+//! \return
+//!
+long CompiledExpression::Binary(InstructionEnum Op, long lhs, long rhs)
+{
+    switch(Op)
+    {
+        case InstructionEnum::OP_LOGICAL_OR:
+            return ((lhs != 0) || (rhs != 0)) ? 1 : 0;
+        case InstructionEnum::OP_LOGICAL_AND:
+            return ((lhs != 0) && (rhs != 0)) ? 1 : 0;
+        case InstructionEnum::OP_BITWISE_OR:
+            return lhs | rhs;
+        case InstructionEnum::OP_BITWISE_XOR:
+            return lhs ^ rhs;
+        case InstructionEnum::OP_BITWISE_AND:
+            return lhs & rhs;
+        case InstructionEnum::OP_EQUAL:
+            return (lhs == rhs) ? 1 : 0;
+        case InstructionEnum::OP_NOT_EQUAL:
+            return (lhs == rhs) ? 0 : 1;
+        case InstructionEnum::OP_LESS:
+            return (lhs < rhs) ? 1 : 0;
+        case InstructionEnum::OP_LESS_OR_EQUAL:
+            return (lhs <= rhs) ? 1 : 0;
+        case InstructionEnum::OP_GREATER:
+            return (lhs > rhs) ? 1 : 0;
+        case InstructionEnum::OP_GREATER_OR_EQUAL:
+            return (lhs >= rhs) ? 1 : 0;
+        case InstructionEnum::OP_SHIFT_LEFT:
+            return lhs << rhs;
+        case InstructionEnum::OP_SHIFT_RIGHT:
+            return lhs >> rhs;
+        case InstructionEnum::OP_PLUS:
+            return lhs + rhs;
+        case InstructionEnum::OP_MINUS:
+            return lhs - rhs;
+        case InstructionEnum::OP_MULTIPLY:
+            return lhs * rhs;
+        case InstructionEnum::OP_DIVIDE:
+            if(rhs == 0)
+                throw ExpressionException("Divide by zero");
+            return lhs / rhs;
+        case InstructionEnum::OP_REMAINDER:
+            if(rhs == 0)
+                throw ExpressionException("Divide by zero");
+            return lhs % rhs;
+        case InstructionEnum::OP_SELECT_BYTE:
+            if(rhs < 0 || rhs > 7)
+                throw ExpressionException("Expected .0 or .1 High/Low selector");
+            if(rhs >= 4 && sizeof(long) < 8)
+                throw ExpressionException(fmt::format(".{Selector} Not supported in this build", fmt::arg("Selector", rhs)));
+            return (lhs >> (rhs * 8)) & 0xFF;
+        default: // Should never happen
+            throw ExpressionException("Unsupported operation in expression");
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef COMPILEDEXPRESSION_H
+#define COMPILEDEXPRESSION_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "symbolnames.h"
+
+//!
+//! \brief The CompiledExpression class
+//! Postfix form of an expression, produced once by ExpressionEvaluatorBase and then
+//! executed against the current symbol tables, Program Counter and Processor.
+//! Operations whose operands are all constant are folded as they are emitted.
+//!
+class CompiledExpression
+{
+public:
+    enum class InstructionEnum : std::uint8_t
+    {
+        OP_PUSH_CONSTANT,           // Operand is the value
+        OP_PUSH_SYMBOL,             // Operand indexes Symbols
+        OP_PUSH_DEFINED,            // Operand indexes Symbols
+        OP_PUSH_NOT_DEFINED,        // Operand indexes Symbols
+        OP_PUSH_PROGRAM_COUNTER,
+        OP_PUSH_PROCESSOR,          // Operand is the minimum CPUTypeEnum
+        OP_NEGATE,
+        OP_BITWISE_NOT,
+        OP_LOGICAL_NOT,
+        OP_HIGH,
+        OP_LOW,
+        OP_LOGICAL_OR,
+        OP_LOGICAL_AND,
+        OP_BITWISE_OR,
+        OP_BITWISE_XOR,
+        OP_BITWISE_AND,
+        OP_EQUAL,
+        OP_NOT_EQUAL,
+        OP_LESS,
+        OP_LESS_OR_EQUAL,
+        OP_GREATER,
+        OP_GREATER_OR_EQUAL,
+        OP_SHIFT_LEFT,
+        OP_SHIFT_RIGHT,
+        OP_PLUS,
+        OP_MINUS,
+        OP_MULTIPLY,
+        OP_DIVIDE,
+        OP_REMAINDER,
+        OP_SELECT_BYTE
+    };
+
+    struct Instruction
+    {
+        InstructionEnum Op;
+        long Operand;
+    };
+
+    CompiledExpression();
+    void Emit(InstructionEnum Op, long Operand = 0);
+    void EmitSymbol(InstructionEnum Op, std::string_view Symbol);
+    static bool IsUnary(InstructionEnum Op);
+    static long Unary(InstructionEnum Op, long Value);
+    static long Binary(InstructionEnum Op, long lhs, long rhs);
+
+    std::vector<Instruction> Code;
+    std::vector<SymbolId> Symbols;
+};
+
+typedef std::unordered_map<std::string, CompiledExpression> ExpressionCache;
+
+#endif // COMPILEDEXPRESSION_H
@@ -5,48 +5,37 @@ ErrorTable::ErrorTable()
 
 }
 
+//!
+//! \brief ErrorTable::Key
+//! \param Location
+//! \return Key of the errors at Location. Global errors have the key of an empty Location.
+//!
+ErrorTable::LocationKey ErrorTable::Key(const SourceLocation& Location)
+{
+    return { Location.File, Location.Macro, Location.Line, Location.InMacro() ? Location.MacroLine : 0 };
+}
+
 //!
 //! \brief PushError
-//! \param SourceFileName
-//! \param LineNumber
+//! \param Location
 //! \param Line
 //! \param Message
 //! \param Severity
 //!
 //! Log the error for output during listing, omitting duplicates
 //!
-void ErrorTable::Push(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const std::string& Message, AssemblyErrorSeverity Severity, bool InMacro)
+void ErrorTable::Push(const SourceLocation& Location, const std::string& Line, const std::string& Message, AssemblyErrorSeverity Severity)
 {
-    std::string FileRef;
-    std::pair<int,int> LineRef;
-    if(InMacro)
-    {
-        FileRef = FileName+"::"+MacroName;
-        LineRef = { LineNumber, MacroLineNumber };
-    }
-    else
+    LocationKey LineRef = Key(Location);
+    auto range = Table.equal_range(LineRef);
+    bool match = false;
+    for(auto it = range.first; it != range.second; it++)
     {
-        FileRef = FileName;
-        LineRef = { LineNumber, 0 };
+        auto MsgSevPair = it->second;
+        match = (MsgSevPair.first == Message) && (MsgSevPair.second == Severity);
     }
-
-    if(Table.count(FileRef) == 0)
-        Table.insert({FileRef, {}});
-
-    if(Table[FileRef].count(LineRef) > 0)
-    {
-        auto range = Table[FileRef].equal_range(LineRef);
-        bool match = false;
-        for(auto it = range.first; it != range.second; it++)
-        {
-            auto MsgSevPair = it->second;
-            match = (MsgSevPair.first == Message) && (MsgSevPair.second == Severity);
-        }
-        if(!match)
-            Table[FileRef].insert({ LineRef, { Message, Severity}});
-    }
-    else
-        Table[FileRef].insert({ LineRef, { Message, Severity}});
+    if(!match)
+        Table.insert({ LineRef, { Message, Severity}});
 }
 
 //!
@@ -58,22 +47,8 @@ void ErrorTable::Push(const std::string& FileName, const int LineNumber, const s
 //!
 void ErrorTable::Push(const std::string& Message, AssemblyErrorSeverity Severity)
 {
-    if(Table.count("") == 0)
-        Table.insert({"", {}});
-
-    Table[""].insert({ {0, 0}, { Message, Severity}});
-}
-
-//!
-//! \brief ErrorTable::count
-//! \param FileName
-//! \return
-//!
-//! Return the number of errors for the given FileName
-//!
-int ErrorTable::count(const std::string& FileName)
-{
-    return Table.count(FileName);
+    Table.insert({ Key(SourceLocation()), { Message, Severity}});
+    GlobalCount++;
 }
 
 //!
@@ -85,47 +60,27 @@ int ErrorTable::count(const std::string& FileName)
 int ErrorTable::count(const AssemblyErrorSeverity Severity)
 {
     int Result = 0;
-    for(auto& FileTable : Table)
-        for(auto& LineTable : FileTable.second)
-        {
-            if(LineTable.second.second == Severity)
-                Result++;
-        }
+    for(auto& Error : Table)
+    {
+        if(Error.second.second == Severity)
+            Result++;
+    }
     return Result;
 }
 
 //!
 //! \brief Contains
-//! \param FileName
-//! \param LineNumber
+//! \param Location
 //! \param Message
 //! \param Severity
 //! \return
 //!
 //! Check if the error table already contains the specified error
 //!
-bool ErrorTable::Contains(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Message, AssemblyErrorSeverity Severity, bool InMacro)
+bool ErrorTable::Contains(const SourceLocation& Location, const std::string& Message, AssemblyErrorSeverity Severity)
 {
-    std::string FileRef;
-    std::pair<int,int> LineRef;
-    if(InMacro)
-    {
-        FileRef = FileName+"::"+MacroName;
-        LineRef = { LineNumber, MacroLineNumber };
-    }
-    else
-    {
-        FileRef = FileName;
-        LineRef = { LineNumber, 0 };
-    }
-
-    auto FileTable = Table.find(FileRef);
-    if(FileTable == Table.end())
-        return false;
-
-    auto& LineTable = FileTable->second;
-    auto ErrorTable = LineTable.find(LineRef);
-    if(ErrorTable == LineTable.end())
+    auto ErrorTable = Table.find(Key(Location));
+    if(ErrorTable == Table.end())
         return false;
 
     auto& MessagePair = ErrorTable->second;
@@ -136,13 +91,11 @@ bool ErrorTable::Contains(const std::string& FileName, const int LineNumber, con
 }
 
 //!
-//! \brief ErrorTable::operator []
-//! \param FileName
-//! \return
-//!
-//! Convenience operator[]
+//! \brief ErrorTable::Find
+//! \param Location
+//! \return The errors logged at Location, in the order they were pushed
 //!
-std::multimap<std::pair<int,int>, std::pair<std::string, AssemblyErrorSeverity>>& ErrorTable::operator[](const std::string FileName)
+std::pair<ErrorTable::MessageTable::const_iterator, ErrorTable::MessageTable::const_iterator> ErrorTable::Find(const SourceLocation& Location) const
 {
-    return Table[FileName];
+    return Table.equal_range(Key(Location));
 }
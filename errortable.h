@@ -1,6 +1,10 @@
+#include <cstddef>
 #include <map>
 #include <string>
+#include <tuple>
+#include <utility>
 #include "assemblyexception.h"
+#include "sourcelocation.h"
 
 #ifndef ERRORTABLE_H
 #define ERRORTABLE_H
@@ -8,21 +12,33 @@
 class ErrorTable
 {
 public:
+    // File, Macro, LineNumber, MacroLineNumber (0 if not within a macro)
+    typedef std::tuple<SourceNameId, SourceNameId, int, int> LocationKey;
+    typedef std::multimap<LocationKey, std::pair<std::string, AssemblyErrorSeverity>> MessageTable;
+
     ErrorTable();
-    void Push(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const std::string& Message, AssemblyErrorSeverity Severity, bool InMacro);
+    void Push(const SourceLocation& Location, const std::string& Line, const std::string& Message, AssemblyErrorSeverity Severity);
     void Push(const std::string& Message, AssemblyErrorSeverity Severity);
-    int count(const std::string& FileName);
     int count(const AssemblyErrorSeverity);
-    bool Contains(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Message, AssemblyErrorSeverity Severity, bool InMacro);
-    std::multimap<std::pair<int,int>, std::pair<std::string, AssemblyErrorSeverity>>& operator[](const std::string FileName);
+    inline bool empty() const
+    {
+        return Table.empty();
+    }
+    inline bool HasLineErrors() const
+    {
+        return Table.size() > GlobalCount;
+    }
+    bool Contains(const SourceLocation& Location, const std::string& Message, AssemblyErrorSeverity Severity);
+    std::pair<MessageTable::const_iterator, MessageTable::const_iterator> Find(const SourceLocation& Location) const;
 
 private:
     // Error Cache:
-    // FileName: LineNumber: Error Message / Severity
-    //                       Error Message / Severity
-    //           LineNumber: Error Message / Severity
-    // FileName: LineNumber: Error Message / Severity
-    std::map<std::string, std::multimap<std::pair<int,int>,std::pair<std::string, AssemblyErrorSeverity>>> Table;
+    // Location: Error Message / Severity
+    //           Error Message / Severity
+    // Location: Error Message / Severity
+    MessageTable Table;
+    std::size_t GlobalCount = 0;    // Errors not logged against a line
+    static LocationKey Key(const SourceLocation& Location);
 };
 
 #endif // ERRORTABLE_H
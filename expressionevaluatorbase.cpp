@@ -1,370 +1,513 @@
+#include <algorithm>
 #include "expressionexception.h"
 #include "expressionevaluatorbase.h"
 
-ExpressionEvaluatorBase::ExpressionEvaluatorBase()
+ExpressionEvaluatorBase::ExpressionEvaluatorBase(CPUTypeEnum Processor, ExpressionCache* Cache) :
+    Processor(Processor),
+    Cache(Cache)
 {
 }
 
-long ExpressionEvaluatorBase::Evaluate(std::string& Expression)
+//!
+//! \brief ExpressionEvaluatorBase::Evaluate
+//! \param Expression
+//! \return
+//!
+//! Evaluate Expression, throwing an ExpressionException if it is invalid or refers to
+//! a symbol without a value.
+//!
+long ExpressionEvaluatorBase::Evaluate(const std::string& Expression)
+{
+    ExpressionResult Result;
+    try
+    {
+        Result = TryEvaluate(Expression);
+    }
+    catch(ExpressionException Ex)
+    {
+        // An unresolved symbol ahead of the error is reported first
+        if(!Unresolved.empty())
+            throw ExpressionException(UnresolvedMessage);
+        throw;
+    }
+    if(!Result.Value.has_value())
+        throw ExpressionException(UnresolvedMessage);
+    return Result.Value.value();
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::TryEvaluate
+//! \param Expression
+//! \return
+//!
+//! Evaluate Expression, returning an unresolved result, rather than throwing, if it refers
+//! to symbols without a value. Invalid expressions still throw an ExpressionException.
+//!
+ExpressionResult ExpressionEvaluatorBase::TryEvaluate(const std::string& Expression)
+{
+    Unresolved.clear();
+    UnresolvedMessage.clear();
+
+    long Result = Execute(Compile(Expression));
+
+    if(!Unresolved.empty())
+        return { {}, Unresolved };
+    return { Result, {} };
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::ConstantValue
+//! \param Expression
+//! \return Value of Expression, if it is made up of constants alone
+//!
+//! Expressions that refer to symbols, the Program Counter or the processor have no value
+//! until evaluated in context. Invalid expressions throw an ExpressionException.
+//!
+std::optional<long> ExpressionEvaluatorBase::ConstantValue(const std::string& Expression)
+{
+    Unresolved.clear();
+    UnresolvedMessage.clear();
+
+    const CompiledExpression& Program = Compile(Expression);
+    if(Program.Code.size() == 1 && Program.Code[0].Op == InstructionEnum::OP_PUSH_CONSTANT)
+        return Program.Code[0].Operand;
+    return {};
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::Compile
+//! \param Expression
+//! \return
+//!
+//! Return the compiled form of Expression, from the cache if it has been seen before.
+//! Compilation depends only on the text, so the result is valid in any context.
+//! On a syntax error, the code compiled so far is executed before the error is rethrown,
+//! so that symbols referenced ahead of the error are still counted and reported.
+//!
+const CompiledExpression& ExpressionEvaluatorBase::Compile(const std::string& Expression)
+{
+    if(Cache != nullptr)
+    {
+        auto Entry = Cache->find(Expression);
+        if(Entry != Cache->end())
+            return Entry->second;
+    }
+
+    Code = CompiledExpression();
+    if(!TokenStream.has_value())
+        TokenStream.emplace();
+    TokenStream->Initialize(Expression);
+    try
+    {
+        CompileSubExpression();
+        auto Token = TokenStream->Peek();
+        if(Token != ExpressionTokenizer::TokenEnum::TOKEN_END && Token != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+            throw ExpressionException("Extra Characters at end of expression");
+    }
+    catch(ExpressionException Ex)
+    {
+        Execute(Code);
+        throw;
+    }
+
+    if(Cache != nullptr)
+        return Cache->emplace(Expression, std::move(Code)).first->second;
+    return Code;
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::Execute
+//! \param Program
+//! \return
+//!
+//! Run compiled code against the current context. Unresolved symbols are taken as zero.
+//!
+long ExpressionEvaluatorBase::Execute(const CompiledExpression& Program)
+{
+    std::vector<long> Stack;
+    Stack.reserve(Program.Code.size());
+    for(auto& Instruction : Program.Code)
+    {
+        switch(Instruction.Op)
+        {
+            case InstructionEnum::OP_PUSH_CONSTANT:
+                Stack.push_back(Instruction.Operand);
+                break;
+            case InstructionEnum::OP_PUSH_SYMBOL:
+                Stack.push_back(SymbolValue(Program.Symbols[Instruction.Operand]));
+                break;
+            case InstructionEnum::OP_PUSH_DEFINED:
+                Stack.push_back(SymbolDefined(Program.Symbols[Instruction.Operand]) ? 1 : 0);
+                break;
+            case InstructionEnum::OP_PUSH_NOT_DEFINED:
+                Stack.push_back(SymbolDefined(Program.Symbols[Instruction.Operand]) ? 0 : 1);
+                break;
+            case InstructionEnum::OP_PUSH_PROGRAM_COUNTER:
+                Stack.push_back(ProgramCounterValue());
+                break;
+            case InstructionEnum::OP_PUSH_PROCESSOR:
+                Stack.push_back(static_cast<CPUTypeEnum>(Instruction.Operand) <= Processor ? 1 : 0);
+                break;
+            case InstructionEnum::OP_DIVIDE:
+            case InstructionEnum::OP_REMAINDER:
+                if(Stack.back() == 0 && !Unresolved.empty())
+                {
+                    // Value is meaningless until all symbols are resolved
+                    Stack.pop_back();
+                    Stack.back() = 0;
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                if(CompiledExpression::IsUnary(Instruction.Op))
+                    Stack.back() = CompiledExpression::Unary(Instruction.Op, Stack.back());
+                else
+                {
+                    long rhs = Stack.back();
+                    Stack.pop_back();
+                    Stack.back() = CompiledExpression::Binary(Instruction.Op, Stack.back(), rhs);
+                }
+                break;
+        }
+    }
+    return Stack.empty() ? 0 : Stack.back();
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::AddUnresolved
+//! \param Symbol
+//! \param Message
+//!
+//! Record a symbol that has no value. Evaluation continues, with the symbol taken as zero,
+//! so that the remainder of the expression is still checked.
+//!
+void ExpressionEvaluatorBase::AddUnresolved(const std::string& Symbol, const std::string& Message)
+{
+    if(Unresolved.empty())
+        UnresolvedMessage = Message;
+    if(std::find(Unresolved.begin(), Unresolved.end(), Symbol) == Unresolved.end())
+        Unresolved.push_back(Symbol);
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::SymbolValue
+//! \param Label
+//! \return Value of Label, recording it as unresolved if it has none
+//!
+long ExpressionEvaluatorBase::SymbolValue(SymbolId /*Label*/)
+{
+    return 0;
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::SymbolDefined
+//! \param Label
+//! \return True if Label is in scope
+//!
+bool ExpressionEvaluatorBase::SymbolDefined(SymbolId /*Label*/)
+{
+    return false;
+}
+
+//!
+//! \brief ExpressionEvaluatorBase::ProgramCounterValue
+//! \return
+//!
+long ExpressionEvaluatorBase::ProgramCounterValue()
 {
-    TokenStream.Initialize(Expression);
-    long Result = EvaluateSubExpression();
-    auto Token = TokenStream.Peek();
-    if(Token != ExpressionTokenizer::TokenEnum::TOKEN_END && Token != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
-        throw ExpressionException("Extra Characters at end of expression");
-    return Result;
+    return 0;
 }
 
 //!
 //! \brief SubExp0
 //! Lowest Precedence
 //! Logical OR
-//! \return
 //!
-long ExpressionEvaluatorBase::EvaluateSubExpression()
+void ExpressionEvaluatorBase::CompileSubExpression()
 {
-    long Result = SubExp1();
-    while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_OR)
+    SubExp1();
+    while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_OR)
     {
-        TokenStream.Get();
-        long rhs = SubExp1();
-        Result = ((Result != 0) || (rhs != 0))  ? 1 : 0;
+        TokenStream->Get();
+        SubExp1();
+        Code.Emit(InstructionEnum::OP_LOGICAL_OR);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp1
 //! Logical AND
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp1()
+void ExpressionEvaluatorBase::SubExp1()
 {
-    long Result = SubExp2();
-    while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_AND)
+    SubExp2();
+    while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_AND)
     {
-        TokenStream.Get();
-        long rhs = SubExp2();
-        Result = ((Result != 0) && (rhs != 0)) ? 1 : 0;
+        TokenStream->Get();
+        SubExp2();
+        Code.Emit(InstructionEnum::OP_LOGICAL_AND);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp2
 //! Bitwise OR
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp2()
+void ExpressionEvaluatorBase::SubExp2()
 {
-    long Result = SubExp3();
-    while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_OR)
+    SubExp3();
+    while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_OR)
     {
-        TokenStream.Get();
-        Result |= SubExp3();
+        TokenStream->Get();
+        SubExp3();
+        Code.Emit(InstructionEnum::OP_BITWISE_OR);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp3
 //! Bitwise XOR
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp3()
+void ExpressionEvaluatorBase::SubExp3()
 {
-    long Result = SubExp4();
-    while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_XOR)
+    SubExp4();
+    while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_XOR)
     {
-        TokenStream.Get();
-        Result ^= SubExp4();
+        TokenStream->Get();
+        SubExp4();
+        Code.Emit(InstructionEnum::OP_BITWISE_XOR);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp4
 //! Bitwise AND
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp4()
+void ExpressionEvaluatorBase::SubExp4()
 {
-    long Result = SubExp5();
-    while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_AND)
+    SubExp5();
+    while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_AND)
     {
-        TokenStream.Get();
-        Result &= SubExp5();
+        TokenStream->Get();
+        SubExp5();
+        Code.Emit(InstructionEnum::OP_BITWISE_AND);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp5
 //! EQUAL / NOT EQUAL
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp5()
+void ExpressionEvaluatorBase::SubExp5()
 {
-    long Result = SubExp6();
-    auto Token = TokenStream.Peek();
+    SubExp6();
+    auto Token = TokenStream->Peek();
     while(Token == ExpressionTokenizer::TokenEnum::TOKEN_EQUAL || Token == ExpressionTokenizer::TokenEnum::TOKEN_NOT_EQUAL)
     {
-        Token = TokenStream.Get();
+        Token = TokenStream->Get();
+        SubExp6();
         switch(Token)
         {
             case ExpressionTokenizer::TokenEnum::TOKEN_EQUAL:
-                Result = (Result == SubExp6()) ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_EQUAL);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_NOT_EQUAL:
-                Result = (Result == SubExp6()) ? 0 : 1;
+                Code.Emit(InstructionEnum::OP_NOT_EQUAL);
                 break;
             default:
                 break;
         }
-        Token = TokenStream.Peek();
+        Token = TokenStream->Peek();
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp6
 //! LESS / LESS or EQUAL / GREATER / GREATER or EQUAL
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp6()
+void ExpressionEvaluatorBase::SubExp6()
 {
-    long Result = SubExp7();
-    auto Token = TokenStream.Peek();
+    SubExp7();
+    auto Token = TokenStream->Peek();
     while(Token == ExpressionTokenizer::TokenEnum::TOKEN_LESS || Token == ExpressionTokenizer::TokenEnum::TOKEN_LESS_OR_EQUAL || Token == ExpressionTokenizer::TokenEnum::TOKEN_GREATER || Token == ExpressionTokenizer::TokenEnum::TOKEN_GREATER_OR_EQUAL)
     {
-        Token = TokenStream.Get();
+        Token = TokenStream->Get();
+        SubExp7();
         switch(Token)
         {
             case ExpressionTokenizer::TokenEnum::TOKEN_LESS:
-                Result = (Result < SubExp7()) ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_LESS);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_LESS_OR_EQUAL:
-                Result = (Result <= SubExp7()) ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_LESS_OR_EQUAL);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_GREATER:
-                Result = (Result > SubExp7()) ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_GREATER);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_GREATER_OR_EQUAL:
-                Result = (Result >= SubExp7()) ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_GREATER_OR_EQUAL);
                 break;
             default:
                 break;
         }
-        Token = TokenStream.Peek();
+        Token = TokenStream->Peek();
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp7
 //! Shift LEFT / RIGHT
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp7()
+void ExpressionEvaluatorBase::SubExp7()
 {
-    long Result = SubExp8();
-    auto Token = TokenStream.Peek();
+    SubExp8();
+    auto Token = TokenStream->Peek();
     while(Token == ExpressionTokenizer::TokenEnum::TOKEN_SHIFT_LEFT || Token == ExpressionTokenizer::TokenEnum::TOKEN_SHIFT_RIGHT)
     {
-        Token = TokenStream.Get();
+        Token = TokenStream->Get();
+        SubExp8();
         switch(Token)
         {
             case ExpressionTokenizer::TokenEnum::TOKEN_SHIFT_LEFT:
-                Result <<= SubExp8();
+                Code.Emit(InstructionEnum::OP_SHIFT_LEFT);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_SHIFT_RIGHT:
-                Result >>= SubExp8();
+                Code.Emit(InstructionEnum::OP_SHIFT_RIGHT);
                 break;
             default:
                 break;
         }
-        Token = TokenStream.Peek();
+        Token = TokenStream->Peek();
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp8
 //! ADDITION / SUPTRACTION
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp8()
+void ExpressionEvaluatorBase::SubExp8()
 {
-    long Result = SubExp9();
-    auto Token = TokenStream.Peek();
+    SubExp9();
+    auto Token = TokenStream->Peek();
     while(Token == ExpressionTokenizer::TokenEnum::TOKEN_PLUS || Token == ExpressionTokenizer::TokenEnum::TOKEN_MINUS)
     {
-        Token = TokenStream.Get();
+        Token = TokenStream->Get();
+        SubExp9();
         switch(Token)
         {
             case ExpressionTokenizer::TokenEnum::TOKEN_PLUS:
-                Result += SubExp9();
+                Code.Emit(InstructionEnum::OP_PLUS);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_MINUS:
-                Result -= SubExp9();
+                Code.Emit(InstructionEnum::OP_MINUS);
                 break;
             default:
                 break;
         }
-        Token = TokenStream.Peek();
+        Token = TokenStream->Peek();
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp9
 //! MULTIPLY / DIVIDE / REMAINDER
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp9()
+void ExpressionEvaluatorBase::SubExp9()
 {
-    long Result = SubExp10();
-    auto Token = TokenStream.Peek();
+    SubExp10();
+    auto Token = TokenStream->Peek();
     while(Token == ExpressionTokenizer::TokenEnum::TOKEN_MULTIPLY || Token == ExpressionTokenizer::TokenEnum::TOKEN_DIVIDE || Token == ExpressionTokenizer::TokenEnum::TOKEN_REMAINDER)
     {
-        Token = TokenStream.Get();
+        Token = TokenStream->Get();
+        SubExp10();
         switch(Token)
         {
             case ExpressionTokenizer::TokenEnum::TOKEN_MULTIPLY:
-                Result *= SubExp10();
+                Code.Emit(InstructionEnum::OP_MULTIPLY);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_DIVIDE:
-            {
-                long Operand = SubExp10();
-                if(Operand == 0)
-                    throw ExpressionException("Divide by zero");
-                Result /= Operand;
+                Code.Emit(InstructionEnum::OP_DIVIDE);
                 break;
-            }
             case ExpressionTokenizer::TokenEnum::TOKEN_REMAINDER:
-            {
-                long Operand = SubExp10();
-                if(Operand == 0)
-                    throw ExpressionException("Divide by zero");
-                Result %= Operand;
+                Code.Emit(InstructionEnum::OP_REMAINDER);
                 break;
-            }
             default:
                 break;
         }
-        Token = TokenStream.Peek();
+        Token = TokenStream->Peek();
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp10
 //! . Postfix operator - select byte
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp10()
+void ExpressionEvaluatorBase::SubExp10()
 {
-    long Result = SubExp11();
-    if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_DOT)
+    SubExp11();
+    if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_DOT)
     {
-        TokenStream.Get();
-        long Selector = SubExp11();
-        switch(Selector)
-        {
-            case 0:
-                Result = Result & 0xFF;
-                break;
-            case 1:
-                Result = (Result >> 8) & 0xFF;
-                break;
-            case 2:
-                Result = (Result >> 16) & 0xFF;
-                break;
-            case 3:
-                Result = (Result >> 24) & 0xFF;
-                break;
-            case 4:
-                if(sizeof(long) < 8)
-                    throw ExpressionException(".4 Not supported in this build");
-                Result = (Result >> 32) & 0xFF;
-                break;
-            case 5:
-                if(sizeof(long) < 8)
-                    throw ExpressionException(".5 Not supported in this build");
-                Result = (Result >> 40) & 0xFF;
-                break;
-            case 6:
-                if(sizeof(long) < 8)
-                    throw ExpressionException(".6 Not supported in this build");
-                Result = (Result >> 48) & 0xFF;
-                break;
-            case 7:
-                if(sizeof(long) < 8)
-                    throw ExpressionException(".7 Not supported in this build");
-                Result = (Result >> 56) & 0xFF;
-                break;
-            default:
-                throw ExpressionException("Expected .0 or .1 High/Low selector");
-        }
+        TokenStream->Get();
+        SubExp11();
+        Code.Emit(InstructionEnum::OP_SELECT_BYTE);
     }
-    return Result;
 }
 
 //!
 //! \brief ExpressionEvaluator::SubExp11
 //! Unary PLUS / MINUS / Bitwise NOT / Logical NOT
-//! \return
 //!
-long ExpressionEvaluatorBase::SubExp11()
+void ExpressionEvaluatorBase::SubExp11()
 {
-    auto Token = TokenStream.Peek();
+    auto Token = TokenStream->Peek();
     if(Token == ExpressionTokenizer::TokenEnum::TOKEN_PLUS || Token == ExpressionTokenizer::TokenEnum::TOKEN_MINUS || Token == ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_NOT || Token == ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_NOT)
     {
-        TokenStream.Get();
+        TokenStream->Get();
+        SubExp11();
         switch(Token)
         {
-            case ExpressionTokenizer::TokenEnum::TOKEN_PLUS:
-                return SubExp11();
-                break;
             case ExpressionTokenizer::TokenEnum::TOKEN_MINUS:
-                return -SubExp11();
+                Code.Emit(InstructionEnum::OP_NEGATE);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_BITWISE_NOT:
-                return ~SubExp11();
+                Code.Emit(InstructionEnum::OP_BITWISE_NOT);
                 break;
             case ExpressionTokenizer::TokenEnum::TOKEN_LOGICAL_NOT:
-                return SubExp11() ? 1 : 0;
+                Code.Emit(InstructionEnum::OP_LOGICAL_NOT);
                 break;
             default:
                 break;
         }
     }
-    return AtomValue();
+    else
+        CompileAtom();
 }
 
 //!
 //! \brief ExpressionEvaluator::GetFunctionArguments
-//! Evaluate function arguments and populate the passed vector.
-//! \param Arguments
+//! Compile function arguments, leaving their values on the stack in order.
 //! \param Count
 //! \return True if correct number of arguments were found
 //!
-bool ExpressionEvaluatorBase::GetFunctionArguments(std::vector<long> &Arguments, int Count)
+bool ExpressionEvaluatorBase::GetFunctionArguments(int Count)
 {
-    if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
-        TokenStream.Get();
+    int Arguments = 0;
+    if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+        TokenStream->Get();
     else
     {
-        Arguments.push_back(EvaluateSubExpression());
-        while(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_COMMA)
+        CompileSubExpression();
+        Arguments++;
+        while(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_COMMA)
         {
-            TokenStream.Get();
-            Arguments.push_back(EvaluateSubExpression());
+            TokenStream->Get();
+            CompileSubExpression();
+            Arguments++;
         }
-        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
-            TokenStream.Get();
+        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+            TokenStream->Get();
         else
             throw ExpressionException("Syntax error in argument list");
     }
-    return Arguments.size() == Count;
+    return Arguments == Count;
 }
@@ -2,35 +2,63 @@
 #define EXPRESSIONEVALUATORBASE_H
 
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
+#include "compiledexpression.h"
 #include "expressiontokenizer.h"
+#include "opcodetable.h"
+
+//!
+//! \brief The ExpressionResult struct
+//! Result of a non-throwing evaluation. If any symbols could not be resolved, Value is
+//! empty and Unresolved lists their names, in the order they were referenced.
+//!
+struct ExpressionResult
+{
+    std::optional<long> Value;
+    std::vector<std::string> Unresolved;
+};
 
 class ExpressionEvaluatorBase
 {
 public:
-    ExpressionEvaluatorBase();
-    long Evaluate(std::string& Expression);
+    ExpressionEvaluatorBase(CPUTypeEnum Processor, ExpressionCache* Cache = nullptr);
+    long Evaluate(const std::string& Expression);
+    ExpressionResult TryEvaluate(const std::string& Expression);
+    std::optional<long> ConstantValue(const std::string& Expression);
 
 protected:
-    bool GetFunctionArguments(std::vector<long>& Arguments, int Count);
-    ExpressionTokenizer TokenStream;
+    typedef CompiledExpression::InstructionEnum InstructionEnum;
+    bool GetFunctionArguments(int Count);
+    void AddUnresolved(const std::string& Symbol, const std::string& Message);
+    std::optional<ExpressionTokenizer> TokenStream;   // Only constructed when an expression has to be compiled
+    CompiledExpression Code;                          // Expression being compiled
+    const CPUTypeEnum Processor;
+    ExpressionCache* Cache;
+    std::vector<std::string> Unresolved;
+    std::string UnresolvedMessage;      // Error reported by Evaluate() for the first unresolved symbol
 
 private:
-    long SubExp1();
-    long SubExp2();
-    long SubExp3();
-    long SubExp4();
-    long SubExp5();
-    long SubExp6();
-    long SubExp7();
-    long SubExp8();
-    long SubExp9();
-    long SubExp10();
-    long SubExp11();
+    const CompiledExpression& Compile(const std::string& Expression);
+    long Execute(const CompiledExpression& Program);
+    void SubExp1();
+    void SubExp2();
+    void SubExp3();
+    void SubExp4();
+    void SubExp5();
+    void SubExp6();
+    void SubExp7();
+    void SubExp8();
+    void SubExp9();
+    void SubExp10();
+    void SubExp11();
 protected:
-    long EvaluateSubExpression();
-    virtual long AtomValue() = 0;
+    void CompileSubExpression();
+    virtual void CompileAtom() = 0;
+    virtual long SymbolValue(SymbolId Label);
+    virtual bool SymbolDefined(SymbolId Label);
+    virtual long ProgramCounterValue();
 };
 
 #endif // EXPRESSIONEVALUATORBASE_H
@@ -1,7 +1,30 @@
+#include <charconv>
 #include "expressiontokenizer.h"
 #include "expressionexception.h"
 #include "utils.h"
 
+//!
+//! \brief ParseDigits
+//! \param Digits
+//! \param Base
+//! \param Value
+//! \return True if Digits is a non-empty run of valid digits in the given Base
+//!
+static bool ParseDigits(std::string_view Digits, int Base, long& Value)
+{
+    if(Digits.empty())
+        return false;
+
+    unsigned long Result = 0;
+    auto [End, Error] = std::from_chars(Digits.data(), Digits.data() + Digits.size(), Result, Base);
+    if(End != Digits.data() + Digits.size())
+        return false;
+    if(Error == std::errc::result_out_of_range)
+        throw ExpressionException("Invalid integer constant");
+    Value = static_cast<long>(Result);
+    return true;
+}
+
 ExpressionTokenizer::ExpressionTokenizer()
 {
 }
@@ -10,13 +33,15 @@ ExpressionTokenizer::ExpressionTokenizer()
 //! \brief ExpressionTokenizer::Initialize
 //! \param Expression
 //!
-//! Initialise the tokenizer with the given string expression
+//! Initialise the tokenizer with the given string expression.
+//! Expression must remain valid until tokenizing is complete.
 //!
-void ExpressionTokenizer::Initialize(std::string& Expression)
+void ExpressionTokenizer::Initialize(const std::string& Expression)
 {
-    InputStream.str(Expression);
-    InputStream.seekg(0);
-    InputStream.clear();
+    Input = Expression;
+    UpperCase = Expression;
+    ToUpper(UpperCase);
+    Position = 0;
     PeekValid = false;
 }
 
@@ -24,17 +49,18 @@ void ExpressionTokenizer::Initialize(std::string& Expression)
 //! \brief ExpressionTokenizer::Peek
 //! \return
 //!
-//! Return the next token in the input stream without actually retrieving it.
+//! Return the next token in the input without actually retrieving it.
+//! The token is scanned once, and returned again by the following Get().
 //!
 ExpressionTokenizer::TokenEnum ExpressionTokenizer::Peek()
 {
     if(!PeekValid)
     {
-        std::streampos SavedPos = InputStream.tellg();
-        LastPeek = Get();
+        std::size_t SavedPosition = Position;
+        LastPeek = Scan();
+        PeekEnd = Position;
+        Position = SavedPosition;
         PeekValid = true;
-        InputStream.clear();
-        InputStream.seekg(SavedPos);
     }
     return LastPeek;
 }
@@ -43,415 +69,404 @@ ExpressionTokenizer::TokenEnum ExpressionTokenizer::Peek()
 //! \brief ExpressionTokenizer::Get
 //! \return
 //!
-//! Scan and return the next token in the input stream.
+//! Return the next token in the input.
 //! If the token has a string or integer value, populate the
 //! StringValue or IntegerValue properties.
 //!
 ExpressionTokenizer::TokenEnum ExpressionTokenizer::Get()
 {
-    PeekValid = false;
-    TokenEnum Result;
-    while(!InputStream.eof() && !InputStream.fail() && isspace(InputStream.peek()))
-        InputStream.ignore();
-
-    char FirstChar = InputStream.get();
-    if(InputStream.eof() || InputStream.fail())
-        Result = TokenEnum::TOKEN_END;
-    else
+    if(PeekValid)
     {
-        switch(FirstChar)
-        {
-            case '"':
-                StringValue = QuotedString();
-                Result = TokenEnum::TOKEN_QUOTED_STRING;
-                break;
-            case '(':
-                Result = TokenEnum::TOKEN_OPEN_BRACE;
-                break;
-            case ')':
-                Result = TokenEnum::TOKEN_CLOSE_BRACE;
-                break;
-            case '.':
-                Result = TokenEnum::TOKEN_DOT;
-                break;
-            case '+':
-                Result = TokenEnum::TOKEN_PLUS;
-                break;
-            case '-':
-                Result = TokenEnum::TOKEN_MINUS;
-                break;
-            case '*':
-                Result = TokenEnum::TOKEN_MULTIPLY;
-                break;
-            case '/':
-                Result = TokenEnum::TOKEN_DIVIDE;
-                break;
-            case '%':
-                IntegerValue = 0;
-                if(InputStream.peek() == '0' || InputStream.peek() == '1')
-                {
-                    while(!InputStream.eof() && !InputStream.fail() && (InputStream.peek() == '0' || InputStream.peek() == '1'))
-                        IntegerValue = (IntegerValue << 1) + InputStream.get() - '0';
-                    Result = TokenEnum::TOKEN_NUMBER;
-                }
-                else
-                    Result = TokenEnum::TOKEN_REMAINDER;
-                break;
-            case '&':
-                if(!InputStream.eof() && !InputStream.fail() && InputStream.peek() == '&')
-                {
-                    InputStream.ignore();
-                    Result = TokenEnum::TOKEN_LOGICAL_AND;
-                }
-                else
-                    Result = TokenEnum::TOKEN_BITWISE_AND;
-                break;
-            case '^':
-                Result = TokenEnum::TOKEN_BITWISE_XOR;
-                break;
-            case '|':
-                if(!InputStream.eof() && !InputStream.fail() && InputStream.peek() == '|')
-                {
-                    InputStream.ignore();
-                    Result = TokenEnum::TOKEN_LOGICAL_OR;
-                }
-                else
-                    Result = TokenEnum::TOKEN_BITWISE_OR;
-                break;
-            case '~':
-                Result = TokenEnum::TOKEN_BITWISE_NOT;
-                break;
-            case '=':
-                if(!InputStream.eof() && !InputStream.fail() && InputStream.peek() == '=')
-                    InputStream.ignore();
-                Result = TokenEnum::TOKEN_EQUAL;
-                break;
-            case '!':
-                if(!InputStream.eof() && !InputStream.fail() && InputStream.peek() == '=')
-                {
-                    InputStream.ignore();
-                    Result = TokenEnum::TOKEN_NOT_EQUAL;
-                }
-                else
-                    Result =  TokenEnum::TOKEN_LOGICAL_NOT;
-                break;
-            case '$':
-                IntegerValue = 0;
-                if(!isxdigit(InputStream.peek()))
-                    Result = TokenEnum::TOKEN_DOLLAR;
-                else
-                {
-                    while(!InputStream.eof() && !InputStream.fail() && isxdigit(InputStream.peek()))
-                    {
-                        char c = InputStream.get();
-                        int v = (c >= 'A') ? (c >= 'a') ? (c - 'a' + 10) : (c - 'A' + 10) : (c - '0');
-                        IntegerValue = (IntegerValue << 4) + v;
-                    }
-                    Result = TokenEnum::TOKEN_NUMBER;
-                }
-                break;
-            case '<':
-                if(!InputStream.eof() && !InputStream.fail())
-                    switch(InputStream.peek())
-                    {
-                        case '<':
-                            InputStream.ignore();
-                            Result = TokenEnum::TOKEN_SHIFT_LEFT;
-                            break;
-                        case '=':
-                            InputStream.ignore();
-                            Result = TokenEnum::TOKEN_LESS_OR_EQUAL;
-                            break;
-                        default:
-                            Result = TokenEnum::TOKEN_LESS;
-                            break;
-                    }
-                break;
-            case '>':
-                if(!InputStream.eof() && !InputStream.fail())
-                    switch(InputStream.peek())
-                    {
-                        case '>':
-                            InputStream.ignore();
-                            Result = TokenEnum::TOKEN_SHIFT_RIGHT;
-                            break;
-                        case '=':
-                            InputStream.ignore();
-                            Result = TokenEnum::TOKEN_GREATER_OR_EQUAL;
-                            break;
-                        default:
-                            Result = TokenEnum::TOKEN_GREATER;
-                            break;
-                    }
-                break;
-            case '\'':
-                if(InputStream.eof() || InputStream.fail())
-                    throw ExpressionException("Unterminated character constant");
+        PeekValid = false;
+        Position = PeekEnd;
+        return LastPeek;
+    }
+    return Scan();
+}
 
-                if(InputStream.peek() == '\'')
-                    throw ExpressionException("Empty Character constant");
+//!
+//! \brief ExpressionTokenizer::Scan
+//! \return
+//!
+//! Scan the next token from the input
+//!
+ExpressionTokenizer::TokenEnum ExpressionTokenizer::Scan()
+{
+    TokenEnum Result;
+    while(Position < Input.size() && IsSpace(Input[Position]))
+        Position++;
 
-                if(InputStream.peek() == '\\')
-                {
-                    InputStream.ignore();
-                    if(InputStream.eof() || InputStream.fail())
-                        throw ExpressionException("Unterminated character constant");
-                    int EscapedChar = InputStream.get();
-                    if(InputStream.eof() || InputStream.fail())
-                        throw ExpressionException("Unterminated character constant");
-                    if(InputStream.get() != '\'')
-                        throw ExpressionException("Character constant too long");
-                    switch(EscapedChar)
-                    {
-                        case '\'':
-                            IntegerValue = 0x27;
-                            break;
-                        case '\"':
-                            IntegerValue = 0x22;
-                            break;
-                        case '\?':
-                            IntegerValue = 0x3F;
-                            break;
-                        case '\\':
-                            IntegerValue = 0x5C;
-                            break;
-                        case 'a':
-                            IntegerValue = 0x07;
-                            break;
-                        case 'b':
-                            IntegerValue = 0x08;
-                            break;
-                        case 'f':
-                            IntegerValue = 0x0C;
-                            break;
-                        case 'n':
-                            IntegerValue = 0x0A;
-                            break;
-                        case 'r':
-                            IntegerValue = 0x0D;
-                            break;
-                        case 't':
-                            IntegerValue = 0x09;
-                            break;
-                        case 'v':
-                            IntegerValue = 0x0B;
-                            break;
-                        default:
-                            throw ExpressionException("Unrecognised escape sequence");
-                            break;
-                    }
-                }
-                else
-                {
-                    if(InputStream.eof() || InputStream.fail())
-                        throw ExpressionException("Unterminated character constant");
-                    IntegerValue = InputStream.get();
-                    if(InputStream.eof() || InputStream.fail())
-                        throw ExpressionException("Unterminated character constant");
-                    if(InputStream.get() != '\'')
-                    {
-                        if(InputStream.eof() || InputStream.fail())
-                            throw ExpressionException("Unterminated character constant");
-                        else
-                            throw ExpressionException("Character constant too long");
-                    }
-                }
+    if(Position >= Input.size())
+        return TokenEnum::TOKEN_END;
+
+    char FirstChar = Input[Position++];
+    char NextChar = Position < Input.size() ? Input[Position] : '\0';
+    switch(FirstChar)
+    {
+        case '"':
+            QuotedString();
+            Result = TokenEnum::TOKEN_QUOTED_STRING;
+            break;
+        case '(':
+            Result = TokenEnum::TOKEN_OPEN_BRACE;
+            break;
+        case ')':
+            Result = TokenEnum::TOKEN_CLOSE_BRACE;
+            break;
+        case '.':
+            Result = TokenEnum::TOKEN_DOT;
+            break;
+        case '+':
+            Result = TokenEnum::TOKEN_PLUS;
+            break;
+        case '-':
+            Result = TokenEnum::TOKEN_MINUS;
+            break;
+        case '*':
+            Result = TokenEnum::TOKEN_MULTIPLY;
+            break;
+        case '/':
+            Result = TokenEnum::TOKEN_DIVIDE;
+            break;
+        case '%':
+            if(NextChar == '0' || NextChar == '1')
+            {
+                std::size_t Start = Position;
+                while(Position < Input.size() && (Input[Position] == '0' || Input[Position] == '1'))
+                    Position++;
+                ParseDigits(Input.substr(Start, Position - Start), 2, IntegerValue);
                 Result = TokenEnum::TOKEN_NUMBER;
-                break;
-            default:
+            }
+            else
+                Result = TokenEnum::TOKEN_REMAINDER;
+            break;
+        case '&':
+            if(NextChar == '&')
             {
-                if(isalpha(FirstChar) || FirstChar=='_')  // LABEL
-                {
-                    StringValue = FirstChar;
-                    while(!InputStream.eof() && !InputStream.fail() && (isalnum(InputStream.peek()) || InputStream.peek() == '_'))
-                        StringValue.push_back(InputStream.get());
-                    ToUpper(StringValue);
-                    Result = TokenEnum::TOKEN_LABEL;
-                }
-                else if(isdigit(FirstChar)) // NUMBER
-                {
-                    IntegerValue = 0;
+                Position++;
+                Result = TokenEnum::TOKEN_LOGICAL_AND;
+            }
+            else
+                Result = TokenEnum::TOKEN_BITWISE_AND;
+            break;
+        case '^':
+            Result = TokenEnum::TOKEN_BITWISE_XOR;
+            break;
+        case '|':
+            if(NextChar == '|')
+            {
+                Position++;
+                Result = TokenEnum::TOKEN_LOGICAL_OR;
+            }
+            else
+                Result = TokenEnum::TOKEN_BITWISE_OR;
+            break;
+        case '~':
+            Result = TokenEnum::TOKEN_BITWISE_NOT;
+            break;
+        case '=':
+            if(NextChar == '=')
+                Position++;
+            Result = TokenEnum::TOKEN_EQUAL;
+            break;
+        case '!':
+            if(NextChar == '=')
+            {
+                Position++;
+                Result = TokenEnum::TOKEN_NOT_EQUAL;
+            }
+            else
+                Result =  TokenEnum::TOKEN_LOGICAL_NOT;
+            break;
+        case '$':
+            if(!std::isxdigit(static_cast<unsigned char>(NextChar)))
+                Result = TokenEnum::TOKEN_DOLLAR;
+            else
+            {
+                std::size_t Start = Position;
+                while(Position < Input.size() && std::isxdigit(static_cast<unsigned char>(Input[Position])))
+                    Position++;
+                ParseDigits(Input.substr(Start, Position - Start), 16, IntegerValue);
+                Result = TokenEnum::TOKEN_NUMBER;
+            }
+            break;
+        case '<':
+            switch(NextChar)
+            {
+                case '<':
+                    Position++;
+                    Result = TokenEnum::TOKEN_SHIFT_LEFT;
+                    break;
+                case '=':
+                    Position++;
+                    Result = TokenEnum::TOKEN_LESS_OR_EQUAL;
+                    break;
+                default:
+                    Result = TokenEnum::TOKEN_LESS;
+                    break;
+            }
+            break;
+        case '>':
+            switch(NextChar)
+            {
+                case '>':
+                    Position++;
+                    Result = TokenEnum::TOKEN_SHIFT_RIGHT;
+                    break;
+                case '=':
+                    Position++;
+                    Result = TokenEnum::TOKEN_GREATER_OR_EQUAL;
+                    break;
+                default:
+                    Result = TokenEnum::TOKEN_GREATER;
+                    break;
+            }
+            break;
+        case '\'':
+            if(Position >= Input.size())
+                throw ExpressionException("Unterminated character constant");
 
-                    std::string ConstStr(1,FirstChar);
-                    while(!InputStream.eof()
-                            && !InputStream.fail()
-                            && (isxdigit(InputStream.peek())
-                                || tolower(InputStream.peek()) == 'x'
-                                || tolower(InputStream.peek()) == 'h'
-                                || tolower(InputStream.peek()) == 'd'
-                                || tolower(InputStream.peek()) == 'o'
-                                || tolower(InputStream.peek()) == 'b'))
-                    {
-                        char c = tolower(InputStream.get());
-                        ConstStr.push_back(c);
-                    }
+            if(Input[Position] == '\'')
+                throw ExpressionException("Empty Character constant");
 
-                    if(std::regex_match(ConstStr, std::regex("^[01]+b$")))
-                    {
-                        // Binary (....b)
-                        ConstStr.pop_back();
-                        for(int i = 0; i < ConstStr.size(); i++)
-                            IntegerValue = (IntegerValue << 1) + ConstStr[i] - '0';
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^[0-9a-f]+h$")))
-                    {
-                        // Hexadeciman (....h)
-                        ConstStr.pop_back();
-                        for(int i = 0; i < ConstStr.size(); i++)
-                        {
-                            char c = ConstStr[i];
-                            int v = (c >= 'A') ? (c >= 'a') ? (c - 'a' + 10) : (c - 'A' + 10) : (c - '0');
-                            IntegerValue = (IntegerValue << 4) + v;
-                        }
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^[0-7]+o$")))
-                    {
-                        // Octal (....o)
-                        ConstStr.pop_back();
-                        for(int i = 0; i < ConstStr.size(); i++)
-                            IntegerValue = (IntegerValue << 3) + ConstStr[i] - '0';
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^[0-9]+d$")))
-                    {
-                        // Decimal (....d)
-                        ConstStr.pop_back();
-                        for(int i = 0; i < ConstStr.size(); i++)
-                            IntegerValue = (IntegerValue * 10) + ConstStr[i] - '0';
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^0[0-7]*$")))
-                    {
-                        // Octal (....)
-                        for(int i = 0; i < ConstStr.size(); i++)
-                            IntegerValue = (IntegerValue << 3) + ConstStr[i] - '0';
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^0x[0-9a-f]+$")))
-                    {
-                        // Hexadecimal (0x....)
-                        for(int i = 2; i < ConstStr.size(); i++)
-                        {
-                            char c = ConstStr[i];
-                            int v = (c >= 'A') ? (c >= 'a') ? (c - 'a' + 10) : (c - 'A' + 10) : (c - '0');
-                            IntegerValue = (IntegerValue << 4) + v;
-                        }
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else if(std::regex_match(ConstStr, std::regex("^[1-9][0-9]*$")))
-                    {
-                        // Decimal (....)
-                        for(int i = 0; i < ConstStr.size(); i++)
-                            IntegerValue = (IntegerValue * 10) + ConstStr[i] - '0';
-                        Result = TokenEnum::TOKEN_NUMBER;
-                    }
-                    else
-                        throw ExpressionException("Invalid integer constant");
+            if(Input[Position] == '\\')
+            {
+                Position++;
+                if(Position >= Input.size())
+                    throw ExpressionException("Unterminated character constant");
+                char EscapedChar = Input[Position++];
+                if(Position >= Input.size() || Input[Position++] != '\'')
+                    throw ExpressionException("Character constant too long");
+                switch(EscapedChar)
+                {
+                    case '\'':
+                        IntegerValue = 0x27;
+                        break;
+                    case '\"':
+                        IntegerValue = 0x22;
+                        break;
+                    case '\?':
+                        IntegerValue = 0x3F;
+                        break;
+                    case '\\':
+                        IntegerValue = 0x5C;
+                        break;
+                    case 'a':
+                        IntegerValue = 0x07;
+                        break;
+                    case 'b':
+                        IntegerValue = 0x08;
+                        break;
+                    case 'f':
+                        IntegerValue = 0x0C;
+                        break;
+                    case 'n':
+                        IntegerValue = 0x0A;
+                        break;
+                    case 'r':
+                        IntegerValue = 0x0D;
+                        break;
+                    case 't':
+                        IntegerValue = 0x09;
+                        break;
+                    case 'v':
+                        IntegerValue = 0x0B;
+                        break;
+                    default:
+                        throw ExpressionException("Unrecognised escape sequence");
+                        break;
                 }
-                else if(InputStream.eof() || InputStream.fail())
-                    Result = TokenEnum::TOKEN_END;
-                else
-                    throw ExpressionException("Unrecognised token in expression");
             }
+            else
+            {
+                IntegerValue = static_cast<unsigned char>(Input[Position++]);
+                if(Position >= Input.size())
+                    throw ExpressionException("Unterminated character constant");
+                if(Input[Position++] != '\'')
+                    throw ExpressionException("Character constant too long");
+            }
+            Result = TokenEnum::TOKEN_NUMBER;
+            break;
+        default:
+        {
+            if(std::isalpha(static_cast<unsigned char>(FirstChar)) || FirstChar=='_')  // LABEL
+            {
+                std::size_t Start = Position - 1;
+                while(Position < Input.size() && IsWordChar(Input[Position]))
+                    Position++;
+                StringValue = std::string_view(UpperCase).substr(Start, Position - Start);
+                Result = TokenEnum::TOKEN_LABEL;
+            }
+            else if(std::isdigit(static_cast<unsigned char>(FirstChar))) // NUMBER
+            {
+                IntegerValue = Number(Position - 1);
+                Result = TokenEnum::TOKEN_NUMBER;
+            }
+            else
+                throw ExpressionException("Unrecognised token in expression");
         }
     }
     return Result;
 }
 
 //!
-//! \brief ExpressionTokenizer::GetCustomToken
-//! \param Pattern
+//! \brief ExpressionTokenizer::Number
+//! \param Start
 //! \return
 //!
-//! For cases where a non-standard token can be accepted, GetCustomToken will scan the
-//! input stream for a match to the given regular expression. The RE should begin with
-//! ^ and end with .*. If a match is found, then StringValue is set to MatchResult[1]
+//! Scan an integer constant beginning with a digit at Start. Accepted forms are
+//! ....b (binary), ....h (hex), ....o (octal), ....d (decimal), 0.... (octal),
+//! 0x.... (hex) and plain decimal.
 //!
-bool ExpressionTokenizer::GetCustomToken(std::regex Pattern)
+long ExpressionTokenizer::Number(std::size_t Start)
 {
-    std::string Line;
-    while(!InputStream.eof() && !InputStream.fail() && isspace(InputStream.peek()))
-        InputStream.ignore();
+    while(Position < Input.size())
+    {
+        char c = std::tolower(static_cast<unsigned char>(Input[Position]));
+        if(!std::isxdigit(static_cast<unsigned char>(c)) && c != 'x' && c != 'h' && c != 'd' && c != 'o' && c != 'b')
+            break;
+        Position++;
+    }
+    std::string_view Text = Input.substr(Start, Position - Start);
+    std::string_view Body = Text.substr(0, Text.size() - 1);
+    long Result = 0;
 
-    PeekValid = false;
-    std::streampos SavedPos = InputStream.tellg();
-    if(std::getline(InputStream, Line))
+    switch(std::tolower(static_cast<unsigned char>(Text.back())))
     {
-        std::smatch MatchResult;
-        if(regex_match(Line, MatchResult, Pattern))
-        {
-            StringValue = MatchResult[1];
-            InputStream.clear();
-            InputStream.seekg(SavedPos);
-            InputStream.seekg(StringValue.size(), InputStream.cur);
-            return true;
-        }
-        else
+        case 'b':
+            if(ParseDigits(Body, 2, Result))
+                return Result;
+            break;
+        case 'h':
+            if(ParseDigits(Body, 16, Result))
+                return Result;
+            break;
+        case 'o':
+            if(ParseDigits(Body, 8, Result))
+                return Result;
+            break;
+        case 'd':
+            if(ParseDigits(Body, 10, Result))
+                return Result;
+            break;
+    }
+
+    if(Text[0] == '0')
+    {
+        if(Text.size() > 1 && std::tolower(static_cast<unsigned char>(Text[1])) == 'x')
         {
-            InputStream.clear();
-            InputStream.seekg(SavedPos);
-            return false;
+            if(ParseDigits(Text.substr(2), 16, Result))
+                return Result;
         }
+        else if(ParseDigits(Text, 8, Result))
+            return Result;
     }
-    else
+    else if(ParseDigits(Text, 10, Result))
+        return Result;
+
+    throw ExpressionException("Invalid integer constant");
+}
+
+//!
+//! \brief ExpressionTokenizer::GetProcessorDesignation
+//! \return
+//!
+//! Scan for a processor designation, {CDP}180{2,4,5,6}{A}, which is not a standard token.
+//! If one is found, StringValue is set to it.
+//!
+bool ExpressionTokenizer::GetProcessorDesignation()
+{
+    PeekValid = false;
+    while(Position < Input.size() && IsSpace(Input[Position]))
+        Position++;
+
+    std::string_view Designation = std::string_view(UpperCase).substr(Position);
+    std::size_t Length = 0;
+    if(Designation.substr(0, 3) == "CDP")
+        Length = 3;
+    if(Designation.substr(Length, 3) != "180" || Designation.size() < Length + 4)
         return false;
+    switch(Designation[Length + 3])
+    {
+        case '2':
+        case '4':
+        case '5':
+        case '6':
+            Length += 4;
+            break;
+        default:
+            return false;
+    }
+    if(Length < Designation.size() && Designation[Length] == 'A')
+        Length++;
+
+    StringValue = Input.substr(Position, Length);
+    Position += Length;
+    return true;
 }
 
 //!
 //! \brief ExpressionTokenizer::QuotedString
-//! \return
 //!
 //! Scan for a quoted string, expanding escaped characters, returning the found
-//! string content in StringValue
+//! string content in StringValue. A string without escapes is returned in place.
 //!
-std::string ExpressionTokenizer::QuotedString()
+void ExpressionTokenizer::QuotedString()
 {
-    std::string Result;
-    int Len = 0;
-    while(!InputStream.eof() && !InputStream.fail())
+    std::size_t Start = Position;
+    while(Position < Input.size() && Input[Position] != '\"' && Input[Position] != '\\')
+        Position++;
+    if(Position >= Input.size() || Input[Position] == '\"')
     {
-        char ch = InputStream.get();
+        StringValue = Input.substr(Start, Position - Start);
+        if(Position < Input.size())
+            Position++;
+        return;
+    }
+
+    Buffer = Input.substr(Start, Position - Start);
+    while(Position < Input.size())
+    {
+        char ch = Input[Position++];
         if(ch == '\"')
             break;
         if(ch == '\\')
         {
-            ch = InputStream.get();
+            ch = Position < Input.size() ? Input[Position++] : '\0';
             switch(ch)
             {
                 case '\'':
-                    Result += '\'';
+                    Buffer += '\'';
                     break;
                 case '\"':
-                    Result += '\"';
+                    Buffer += '\"';
                     break;
                 case '\?':
-                    Result += '\?';
+                    Buffer += '\?';
                     break;
                 case '\\':
-                    Result += '\\';
+                    Buffer += '\\';
                     break;
                 case 'a':
-                    Result += '\a';
+                    Buffer += '\a';
                     break;
                 case 'b':
-                    Result += '\b';
+                    Buffer += '\b';
                     break;
                 case 'f':
-                    Result += '\f';
+                    Buffer += '\f';
                     break;
                 case 'n':
-                    Result += '\n';
+                    Buffer += '\n';
                     break;
                 case 'r':
-                    Result += '\r';
+                    Buffer += '\r';
                     break;
                 case 't':
-                    Result += '\t';
+                    Buffer += '\t';
                     break;
                 case 'v':
-                    Result += '\v';
+                    Buffer += '\v';
                     break;
                 default:
                     throw ExpressionException("Unrecognised escape sequence in string constant");
@@ -459,8 +474,7 @@ std::string ExpressionTokenizer::QuotedString()
             }
         }
         else
-            Result += ch;
-        Len++;
+            Buffer += ch;
     }
-    return Result;
+    StringValue = Buffer;
 }
@@ -1,10 +1,9 @@
 #ifndef EXPRESSIONTOKENIZER_H
 #define EXPRESSIONTOKENIZER_H
 
-#include <map>
-#include <regex>
-#include <sstream>
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 class ExpressionTokenizer
 {
@@ -43,17 +42,24 @@ public:
     };
 
     ExpressionTokenizer();
-    void Initialize(std::string& Expression);
+    void Initialize(const std::string& Expression);
     TokenEnum Peek();
     TokenEnum Get();
-    bool GetCustomToken(std::regex Pattern);
+    bool GetProcessorDesignation();
     long IntegerValue;
-    std::string StringValue;
+    std::string_view StringValue;   // Valid until the next token is scanned
+
 private:
-    std::istringstream InputStream;
+    std::string_view Input;         // Expression being scanned, owned by the caller
+    std::string UpperCase;          // Upper case copy of Input, for LABEL tokens
+    std::string Buffer;             // Quoted string with escape sequences expanded
+    std::size_t Position = 0;
     bool PeekValid = false;
     TokenEnum LastPeek;
-    std::string QuotedString();
+    std::size_t PeekEnd = 0;        // Position after the peeked token
+    TokenEnum Scan();
+    void QuotedString();
+    long Number(std::size_t Start);
 
 };
 
@@ -1,7 +1,8 @@
+#include <algorithm>
 #include <filesystem>
-#include <fmt/core.h>
-#include <fmt/ostream.h>
-#include <iomanip>
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <iterator>
 #include <vector>
 #include "listingfilewriter.h"
 
@@ -18,155 +19,241 @@ ListingFileWriter::ListingFileWriter(const std::string& FileName, ErrorTable& Er
 
 ListingFileWriter::~ListingFileWriter()
 {
+    Flush();
     if(ListStream.is_open())
         ListStream.close();
 }
 
+//!
+//! \brief ListingFileWriter::Reset
+//!
+//! Discard the lines recorded by an abandoned final pass. Nothing has been written.
+//!
 void ListingFileWriter::Reset()
+{
+    Records.clear();
+    Bytes.clear();
+}
+
+//!
+//! \brief ListingFileWriter::Open
+//!
+//! Create the listing file on the first line listed
+//!
+void ListingFileWriter::Open()
+{
+    if(!ListStream.is_open())
+    {
+        ListStream.open(ListFileName, std::ofstream::out | std::ofstream::trunc);
+    }
+}
+
+//!
+//! \brief ListingFileWriter::Flush
+//!
+//! Write out the buffered listing. Lines are collected in memory and written in large
+//! blocks, rather than formatted into the stream one field at a time.
+//!
+void ListingFileWriter::Flush()
 {
     if(ListStream.is_open())
-        ListStream.close();
-    if(std::filesystem::exists(File))
-        std::filesystem::remove(File);
+        ListStream.write(Buffer.data(), Buffer.size());
+    Buffer.clear();
 }
 
-void ListingFileWriter::Append(const std::string& FullFileName, int LineNumber, const std::string& MacroName, int MacroLineNumber, const std::string& Line, const bool InMacro)
+//!
+//! \brief ListingFileWriter::FileReference
+//! \param Location
+//! \return The file name shown for Location, with the macro if it is within an expansion
+//!
+const std::string& ListingFileWriter::FileReference(const SourceLocation& Location)
 {
-    std::string FileName = std::filesystem::path(FullFileName).filename();
-    std::string FileRef;
-    if(InMacro)
-        FileRef = FileName + "::" + MacroName;
-    else
-        FileRef = FileName;
+    const std::string& FileName = SourceNames::FileName(Location.File);
+    if(!Location.InMacro())
+        return FileName;
 
-    if(Enabled)
-    {
-        if(!ListStream.is_open())
+    auto Reference = MacroReferences.find({ Location.File, Location.Macro });
+    if(Reference == MacroReferences.end())
+        Reference = MacroReferences.insert({ { Location.File, Location.Macro }, FileName + "::" + SourceNames::Name(Location.Macro) }).first;
+    return Reference->second;
+}
+
+//!
+//! \brief ListingFileWriter::AppendBytes
+//! \param Data
+//! \param Size
+//! \param Width
+//!
+//! Append Size bytes as "XX ", padded with spaces to Width bytes
+//!
+void ListingFileWriter::AppendBytes(const std::uint8_t* Data, const std::size_t Size, const std::size_t Width)
+{
+    static const char Hex[] = "0123456789ABCDEF";
+    for(std::size_t i = 0; i < Width; i++)
+        if(i < Size)
         {
-            ListStream.open(ListFileName, std::ofstream::out | std::ofstream::trunc);
+            const char Byte[3] = { Hex[Data[i] >> 4], Hex[Data[i] & 0x0F], ' ' };
+            Buffer.append(Byte, Byte + 3);
         }
-        if(InMacro)
-            fmt::println(ListStream, "[{filename:22.22} {linenumber:05}:{macrolinenumber:02}]                       {line}",
-                         fmt::arg("filename", FileRef),
-                         fmt::arg("linenumber", LineNumber - 1),
-                         fmt::arg("macrolinenumber", MacroLineNumber),
-                         fmt::arg("line", Line)
-                        );
         else
-            fmt::println(ListStream, "[{filename:22.22} {linenumber:05}   ]                       {line}",
-                         fmt::arg("filename", FileName),
-                         fmt::arg("linenumber", LineNumber),
-                         fmt::arg("line", Line)
-                        );
+            Buffer.append(std::string_view("   "));
+}
 
-        PrintError(FileName, LineNumber, MacroName, MacroLineNumber, InMacro);
-    }
+void ListingFileWriter::Append(const SourceLocation& Location, const std::string& Line)
+{
+    if(Enabled)
+        Records.push_back({ Location, &Line, 0, 0, 0, false });
 }
 
-void ListingFileWriter::Append(const std::string& FullFileName, int LineNumber, const std::string& MacroName, int MacroLineNumber, const std::string& Line, const bool InMacro, const std::uint16_t Address, const std::vector<std::uint8_t>& Data)
+void ListingFileWriter::Append(const SourceLocation& Location, const std::string& Line, const std::uint16_t Address, const std::vector<std::uint8_t>& Data)
 {
-    std::string FileName = std::filesystem::path(FullFileName).filename();
-    std::string FileRef;
-    if(InMacro)
-        FileRef = FileName+"::"+MacroName;
-    else
-        FileRef = FileName;
+    Append(Location, Line, Address, Data.data(), Data.size());
+}
 
+//!
+//! \brief ListingFileWriter::Append
+//! \param Location
+//! \param Line
+//! \param Address
+//! \param Data
+//! \param Size
+//!
+//! Record a line that generates Size bytes at Address. Only the bytes shown in the
+//! listing are kept. Line must remain valid until the listing is rendered.
+//!
+void ListingFileWriter::Append(const SourceLocation& Location, const std::string& Line, const std::uint16_t Address, const std::uint8_t* Data, const std::size_t Size)
+{
     if(Enabled)
     {
-        if(!ListStream.is_open())
-        {
-            ListStream.open(ListFileName, std::ofstream::out | std::ofstream::trunc);
-        }
-        if(Data.size() == 0)
-        {
-            if(InMacro)
-                fmt::println(ListStream, "[{filename:22.22} {linenumber:05}:{macrolinenumber:02}]  {address:04X}                 {line}",
-                             fmt::arg("filename", FileRef),
-                             fmt::arg("linenumber", LineNumber - 1),
-                             fmt::arg("macrolinenumber", MacroLineNumber),
-                             fmt::arg("address", Address),
-                             fmt::arg("line", Line)
-                            );
-            else
-                fmt::println(ListStream, "[{filename:22.22} {linenumber:05}   ]  {address:04X}                 {line}",
-                             fmt::arg("filename", FileName),
-                             fmt::arg("linenumber", LineNumber),
-                             fmt::arg("address", Address),
-                             fmt::arg("line", Line)
-                            );
-        }
+        Records.push_back({ Location, &Line, static_cast<std::uint32_t>(Bytes.size()), static_cast<std::uint32_t>(Size), Address, true });
+        Bytes.insert(Bytes.end(), Data, Data + std::min(Size, MaxListedBytes));
+    }
+}
+
+//!
+//! \brief ListingFileWriter::Render
+//!
+//! Write out the lines recorded by the final pass, with the errors logged against each.
+//! Nothing is written if no line was listed.
+//!
+void ListingFileWriter::Render()
+{
+    if(Records.empty())
+        return;
+
+    Open();
+    for(auto& Line : Records)
+    {
+        RenderLine(Line);
+        if(Buffer.size() >= FlushSize)
+            Flush();
+    }
+    Records.clear();
+    Bytes.clear();
+}
+
+void ListingFileWriter::RenderLine(const Record& Line)
+{
+    const SourceLocation& Location = Line.Location;
+    const std::string& Text = *Line.Line;
+    if(!Line.HasAddress)
+    {
+        if(Location.InMacro())
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}:{:02}]                       {}\n"),
+                           FileReference(Location),
+                           Location.Line - 1,
+                           Location.MacroLine,
+                           Text
+                          );
+        else
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}   ]                       {}\n"),
+                           FileReference(Location),
+                           Location.Line,
+                           Text
+                          );
+    }
+    else if(Line.Size == 0)
+    {
+        if(Location.InMacro())
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}:{:02}]  {:04X}                 {}\n"),
+                           FileReference(Location),
+                           Location.Line - 1,
+                           Location.MacroLine,
+                           Line.Address,
+                           Text
+                          );
         else
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}   ]  {:04X}                 {}\n"),
+                           FileReference(Location),
+                           Location.Line,
+                           Line.Address,
+                           Text
+                          );
+    }
+    else
+    {
+        const std::uint8_t* Data = Bytes.data() + Line.Offset;
+        std::size_t Size = Line.Size;
+        int LineCount = (Size - 1) / 4 + 1;
+        for(int i = 0; i < std::min(LineCount, 16); i++)
         {
-            int LineCount = (Data.size() - 1) / 4 + 1;
-            for(int i = 0; i < std::min(LineCount, 16); i++)
-            {
-                if(i == 0)
-                    if(InMacro)
-                        fmt::print(ListStream, "[{filename:22.22} {linenumber:05}:{macrolinenumber:02}]  {address:04X}   ",
-                                   fmt::arg("filename", FileRef),
-                                   fmt::arg("linenumber", LineNumber - 1),
-                                   fmt::arg("macrolinenumber", MacroLineNumber),
-                                   fmt::arg("address", Address)
-                                  );
-                    else
-                        fmt::print(ListStream, "[{filename:22.22} {linenumber:05}   ]  {address:04X}   ",
-                                   fmt::arg("filename", FileName),
-                                   fmt::arg("linenumber", LineNumber),
-                                   fmt::arg("address", Address)
+            if(i == 0)
+                if(Location.InMacro())
+                    fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}:{:02}]  {:04X}   "),
+                                   FileReference(Location),
+                                   Location.Line - 1,
+                                   Location.MacroLine,
+                                   Line.Address
                                   );
                 else
-                    fmt::print(ListStream, "{space:42}", fmt::arg("space", " "));
+                    fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("[{:22.22} {:05}   ]  {:04X}   "),
+                                   FileReference(Location),
+                                   Location.Line,
+                                   Line.Address
+                                  );
+            else
+                Buffer.append(std::string_view("                                          "));
 
-                for(int j = 0; j < 4; j++)
-                    if((i*4)+j < Data.size())
-                        fmt::print(ListStream, "{byte:02X} ", fmt::arg("byte", Data[i*4+j]));
-                    else
-                        fmt::print(ListStream, "{space:2} ", fmt::arg("space", ""));
-                if(i == 0)
-                    fmt::print(ListStream, "  {line}", // Initial spaces to pad line start to an 8 character boundary (to align tabs)
-                               fmt::arg("line", Line)
-                              );
-                fmt::println(ListStream, "");
-            }
-            if(LineCount > 16)
+            AppendBytes(Data + i * 4, std::min<std::size_t>(Size - i * 4, 4), 4);
+            if(i == 0)
             {
-                fmt::println(ListStream, "{space:42}.. .. .. ..           (remaining {bytes} bytes omitted from listing)",
-                             fmt::arg("space", " "),
-                             fmt::arg("bytes", Data.size()-64));
+                // Initial spaces to pad line start to an 8 character boundary (to align tabs)
+                Buffer.append(std::string_view("  "));
+                Buffer.append(Text);
             }
+            Buffer.push_back('\n');
+        }
+        if(LineCount > 16)
+        {
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:42}.. .. .. ..           (remaining {} bytes omitted from listing)\n"),
+                           " ",
+                           Size-64);
         }
-        PrintError(FileName, LineNumber, MacroName, MacroLineNumber, InMacro);
     }
+    PrintError(Location);
 }
 
-void ListingFileWriter::PrintError(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const bool InMacro)
+//!
+//! \brief ListingFileWriter::PrintError
+//! \param Location
+//!
+//! List the errors logged for the line at Location. Nothing need be looked up unless
+//! some error was logged against a line, which is rare in most listings.
+//!
+void ListingFileWriter::PrintError(const SourceLocation& Location)
 {
-    std::string FileRef;
-    std::pair<int,int> LineRef;
-    if(InMacro)
-    {
-        FileRef = FileName+"::"+MacroName;
-        LineRef = { LineNumber, MacroLineNumber };
-    }
-    else
-    {
-        FileRef = FileName;
-        LineRef = { LineNumber, 0 };
-    }
+    if(!Errors.HasLineErrors())
+        return;
 
-    if(Errors.count(FileRef) != 0)
+    auto range = Errors.Find(Location);
+    for(auto it = range.first; it != range.second; it++)
     {
-        auto range = Errors[FileRef].equal_range(LineRef);
-        for(auto it = range.first; it != range.second; it++)
-        {
-            auto MsgSevPair = it->second;
-            std::string Message = MsgSevPair.first;
-            AssemblyErrorSeverity Severity = MsgSevPair.second;
-            fmt::println(ListStream, "**********************************************{severity:*>15}:  {message}",
-                         fmt::arg("severity", " "+AssemblyException::SeverityName.at(Severity)),
-                         fmt::arg("message", Message));
-        }
+        auto MsgSevPair = it->second;
+        const std::string& Message = MsgSevPair.first;
+        AssemblyErrorSeverity Severity = MsgSevPair.second;
+        fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("**********************************************{:*>15}:  {}\n"),
+                       " "+AssemblyException::SeverityName.at(Severity),
+                       Message);
     }
 }
 
@@ -174,18 +261,15 @@ void ListingFileWriter::AppendGlobalErrors()
 {
     if(Enabled)
     {
-        if(Errors.count("") != 0)
+        auto range = Errors.Find(SourceLocation());
+        for(auto& it = range.first; it != range.second; it++)
         {
-            auto range = Errors[""].equal_range({0,0});
-            for(auto& it = range.first; it != range.second; it++)
-            {
-                auto MsgSevPair = it->second;
-                std::string Message = MsgSevPair.first;
-                AssemblyErrorSeverity Severity = MsgSevPair.second;
-                fmt::println(ListStream, "**************************************{severity:*>15}:  {message}",
-                             fmt::arg("severity", " "+AssemblyException::SeverityName.at(Severity)),
-                             fmt::arg("message", Message));
-            }
+            auto MsgSevPair = it->second;
+            const std::string& Message = MsgSevPair.first;
+            AssemblyErrorSeverity Severity = MsgSevPair.second;
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("**************************************{:*>15}:  {}\n"),
+                           " "+AssemblyException::SeverityName.at(Severity),
+                           Message);
         }
     }
 }
@@ -194,49 +278,52 @@ void ListingFileWriter::AppendSymbols(const std::string& Name, const SymbolTable
 {
     if(Enabled)
     {
-        fmt::println(ListStream, "");
+        Buffer.push_back('\n');
 
         if(Blob.Name.empty())
-            fmt::println(ListStream, "{Name:-^116}", fmt::arg("Name", "Global Symbols"));
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:-^116}\n"), "Global Symbols");
         else
         {
-            std::string NameAndSize = fmt::format("{Name} @ ${Address:04X} ({Size} (${Size:04X}) bytes)",
+            // The SUBROUTINE's own label has no value if assembly stopped before it was defined
+            auto Label = Blob.Find(SymbolNames::Id(Name));
+            std::string Address = Label != nullptr && Label->Value.has_value() ? fmt::format("{:04X}", Label->Value.value()) : "----";
+            std::string NameAndSize = fmt::format("{Name} @ ${Address} ({Size} (${Size:04X}) bytes)",
                                                   fmt::arg("Name", Name),
-                                                  fmt::arg("Size",  Blob.CodeSize),
-                                                  fmt::arg("Address", Blob.Symbols.at(Name).Value.value()));
-            fmt::println(ListStream, "{Name:-^116}", fmt::arg("Name", NameAndSize));
+                                                  fmt::arg("Size",  Blob.CodeSize.value_or(0)),
+                                                  fmt::arg("Address", Address));
+            fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:-^116}\n"), NameAndSize);
         }
 
         int c = 0;
-        for(auto& Symbol : Blob.Symbols)
-            if(!Symbol.second.HideFromSymbolTable)
+        for(auto& Symbol : Blob.SortedSymbols())
+            if(!Symbol.second->HideFromSymbolTable)
             {
-                fmt::print(ListStream, "{Name:15} ", fmt::arg("Name", Symbol.first));
-                if(Symbol.second.Value.has_value())
+                fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:15} "), *Symbol.first);
+                if(Symbol.second->Value.has_value())
                 {
-                    if(Symbol.second.Value.value() >= -65536 && Symbol.second.Value.value() <= 65535)
-                        fmt::print(ListStream, "{Address:04X}", fmt::arg("Address", Symbol.second.Value.value() & 0xFFFF));
+                    if(Symbol.second->Value.value() >= -65536 && Symbol.second->Value.value() <= 65535)
+                        fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:04X}"), Symbol.second->Value.value() & 0xFFFF);
                     else
                     {
                         // Fixup for values over 2 bytes long
                         if(c == 3)
                         {
-                            fmt::println(ListStream, "");
+                            Buffer.push_back('\n');
                             c++;
                         }
-                        fmt::print(ListStream, "{Address:08X}", fmt::arg("Address", (unsigned long)Symbol.second.Value.value()));
+                        fmt::format_to(std::back_inserter(Buffer), FMT_COMPILE("{:08X}"), (unsigned long)Symbol.second->Value.value());
                         c++;
                         if(c % 5 != 0)
-                            fmt::print(ListStream, "            ");
+                            Buffer.append(std::string_view("            "));
                     }
                 }
                 else
-                    fmt::print(ListStream, "----");
+                    Buffer.append(std::string_view("----"));
                 if(++c % 5 == 0)
-                    fmt::println(ListStream, "");
+                    Buffer.push_back('\n');
                 else
-                    fmt::print(ListStream, "    ");
+                    Buffer.append(std::string_view("    "));
             }
-        fmt::println(ListStream, "");
+        Buffer.push_back('\n');
     }
 }
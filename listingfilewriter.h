@@ -1,11 +1,16 @@
 #ifndef LISTINGFILEWRITER_H
 #define LISTINGFILEWRITER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
 #include <fstream>
 #include <map>
+#include <utility>
 #include <vector>
 #include "errortable.h"
+#include "sourcelocation.h"
 #include "symboltable.h"
 
 class ListingFileWriter
@@ -14,8 +19,33 @@ private:
     std::filesystem::path File;
     std::string ListFileName;
     std::ofstream ListStream;
+    fmt::memory_buffer Buffer;                      // Listing not yet written to ListStream
+    static constexpr std::size_t FlushSize = 1 << 20;
+    std::map<std::pair<SourceNameId, SourceNameId>, std::string> MacroReferences;   // "File::Macro", by File and Macro
 
-    void PrintError(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const bool InMacro);
+    //!
+    //! \brief The Record struct
+    //! A line listed in the final pass, rendered once assembly is complete
+    //!
+    struct Record
+    {
+        SourceLocation Location;
+        const std::string* Line;                    // Source text, held in the Program
+        std::uint32_t Offset;                       // Start of the listed bytes in Bytes
+        std::uint32_t Size;                         // Number of bytes generated by the line
+        std::uint16_t Address;
+        bool HasAddress;
+    };
+    std::vector<Record> Records;
+    std::vector<std::uint8_t> Bytes;                // Listed bytes of all records
+    static constexpr std::size_t MaxListedBytes = 64;
+
+    void Open();
+    void Flush();
+    const std::string& FileReference(const SourceLocation& Location);
+    void AppendBytes(const std::uint8_t* Data, const std::size_t Size, const std::size_t Width);
+    void PrintError(const SourceLocation& Location);
+    void RenderLine(const Record& Line);
 
 public:
     ListingFileWriter(const std::string& FileName, ErrorTable& Errors, bool Enabled);
@@ -24,8 +54,10 @@ public:
 
     bool Enabled;
 
-    void Append(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const bool InMacro);
-    void Append(const std::string& FileName, const int LineNumber, const std::string& MacroName, const int MacroLineNumber, const std::string& Line, const bool InMacro, const std::uint16_t Address, const std::vector<std::uint8_t>& Data);
+    void Append(const SourceLocation& Location, const std::string& Line);
+    void Append(const SourceLocation& Location, const std::string& Line, const std::uint16_t Address, const std::vector<std::uint8_t>& Data);
+    void Append(const SourceLocation& Location, const std::string& Line, const std::uint16_t Address, const std::uint8_t* Data, const std::size_t Size);
+    void Render();
     void AppendGlobalErrors();
     void AppendSymbols(const std::string& Name, const SymbolTable& Symbols);
     ErrorTable& Errors;
@@ -1,6 +1,102 @@
+#include <cctype>
 #include "macro.h"
 
 Macro::Macro()
 {
 
 }
+
+//!
+//! \brief Macro::Compile
+//! \param Line
+//!
+//! Append a line of the definition. Identifiers matching an argument name (case insensitive)
+//! become argument slots, including within a comment; text within quotes is kept verbatim.
+//!
+void Macro::Compile(const std::string& Line)
+{
+    std::vector<Segment>& Segments = Lines.emplace_back();
+    std::string Literal;
+
+    char Quote = 0;
+    bool inEscape = false;
+
+    for(std::size_t i = 0; i < Line.size(); i++)
+    {
+        char ch = Line[i];
+
+        if(inEscape)
+            inEscape = false;
+        else if(Quote != 0)
+        {
+            if(ch == '\\')
+                inEscape = true;
+            else if(ch == Quote)
+                Quote = 0;
+        }
+        else if(ch == '\'' || ch == '\"')
+            Quote = ch;
+        else if(std::isalnum(static_cast<unsigned char>(ch)) || ch == '_')
+        {
+            std::size_t End = i;
+            while(End < Line.size() && (std::isalnum(static_cast<unsigned char>(Line[End])) || Line[End] == '_'))
+                End++;
+            std::string_view Identifier(Line.data() + i, End - i);
+            int Argument = FindArgument(Identifier);
+            if(Argument != LITERAL)
+            {
+                if(!Literal.empty())
+                    Segments.push_back({ std::move(Literal), LITERAL });
+                Literal.clear();
+                Segments.push_back({ "", Argument });
+            }
+            else
+                Literal += Identifier;
+            i = End - 1;
+            continue;
+        }
+        Literal += ch;
+    }
+    if(!Literal.empty())
+        Segments.push_back({ std::move(Literal), LITERAL });
+}
+
+//!
+//! \brief Macro::Expand
+//! \param Index
+//! \param Operands
+//! \return Line Index of the definition, with the Operands in place of the arguments
+//!
+std::string Macro::Expand(std::size_t Index, const std::vector<std::string>& Operands) const
+{
+    std::size_t Length = 0;
+    for(auto& Part : Lines[Index])
+        Length += (Part.Argument == LITERAL) ? Part.Text.size() : Operands[Part.Argument].size();
+
+    std::string Output;
+    Output.reserve(Length);
+    for(auto& Part : Lines[Index])
+        Output += (Part.Argument == LITERAL) ? Part.Text : Operands[Part.Argument];
+    return Output;
+}
+
+//!
+//! \brief Macro::FindArgument
+//! \param Identifier
+//! \return Index of the argument named Identifier, or LITERAL if there is none
+//!
+int Macro::FindArgument(std::string_view Identifier) const
+{
+    for(std::size_t i = 0; i < Arguments.size(); i++)
+    {
+        const std::string& Name = Arguments[i];
+        if(Name.size() != Identifier.size())
+            continue;
+        std::size_t j = 0;
+        while(j < Name.size() && Name[j] == std::toupper(static_cast<unsigned char>(Identifier[j])))
+            j++;
+        if(j == Name.size())
+            return static_cast<int>(i);
+    }
+    return LITERAL;
+}
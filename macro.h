@@ -1,15 +1,40 @@
 #ifndef MACRO_H
 #define MACRO_H
 
-#include <vector>
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <vector>
 
+//!
+//! \brief The Macro class
+//! A macro definition, compiled when it is defined into a list of lines, each made up of
+//! literal text and the argument slots to be replaced by the operands of an invocation.
+//!
 class Macro
 {
 public:
+    static constexpr int LITERAL = -1;
+
+    struct Segment
+    {
+        std::string Text;       // Literal text, when Argument is LITERAL
+        int Argument;           // Index into Arguments
+    };
+
     Macro();
-    std::string Expansion;
+    void Compile(const std::string& Line);
+    std::string Expand(std::size_t Index, const std::vector<std::string>& Operands) const;
+    inline std::size_t LineCount() const
+    {
+        return Lines.size();
+    }
+
     std::vector<std::string> Arguments;
+
+private:
+    std::vector<std::vector<Segment>> Lines;
+    int FindArgument(std::string_view Identifier) const;
 };
 
 #endif // MACRO_H
@@ -8,6 +8,7 @@
 #include <map>
 #include <regex>
 #include <string>
+#include <vector>
 #include <getopt.h>
 #include "assembler.h"
 #include "assemblyexception.h"
@@ -33,7 +34,7 @@ int main(int argc, char **argv)
         { "cpu",                required_argument,  0, 'C' }, // Specify target CPU
         { "define",             required_argument,  0, 'D' }, // Define pre-processor variable
         { "undefine",           required_argument,  0, 'U' }, // Un-define pre-processor variable
-        { "keep-preprocessor",  no_argument,        0, 'k' }, // Keep Pre-Processor intermediate file
+        { "keep-preprocessor",  no_argument,        0, 'k' }, // Save Pre-Processor intermediate file
         { "list",               no_argument,        0, 'l' }, // Create a listing file after pass 3
         { "symbols",            no_argument,        0, 's' }, // Include Symbol Table in listing file
         { "noregisters",        no_argument,        0, 'r' }, // Do not pre-define labels for Registers (R0-F, R0-15)
@@ -71,11 +72,11 @@ int main(int argc, char **argv)
             {
                 std::string RequestedCPU = optarg;
                 ToUpper(RequestedCPU);
-                auto CPULookup = OpCodeTable::CPUTable.find(RequestedCPU);
-                if(CPULookup == OpCodeTable::CPUTable.end())
+                auto CPULookup = OpCodeTable::FindCPU(RequestedCPU);
+                if(!CPULookup)
                     fmt::println("Unrecognised CPU Type");
                 else
-                    InitialProcessor = CPULookup->second;
+                    InitialProcessor = CPULookup.value();
                 break;
             }
             case 'D': // Define Pre-Processor variable
@@ -106,7 +107,7 @@ int main(int argc, char **argv)
                 AssemblerPreProcessor.RemoveDefine(optarg);
                 break;
             }
-            case 'k': // Keep Pre-Processor temporary file (.pp)
+            case 'k': // Save Pre-Processor intermediate file (.pp)
                 KeepPreprocessor = true;
                 break;
 
@@ -158,7 +159,7 @@ int main(int argc, char **argv)
                 fmt::println("\tUndefine preprocessor variable");
                 fmt::println("");
                 fmt::println("-k|--keep-preprocessor");
-                fmt::println("\tKeep Pre-Processor temporary file {{filename}}.pp");
+                fmt::println("\tSave Pre-Processor intermediate file {{filename}}.pp");
                 fmt::println("");
                 fmt::println("-l|--list");
                 fmt::println("\tCreate listing file");
@@ -198,22 +199,20 @@ int main(int argc, char **argv)
         {
             fmt::println("Pre-Processing...");
             std::string PreProcessedInputFile;
+            std::vector<std::string> PreProcessedSource;
             std::string FileName = argv[optind++];
-            if(AssemblerPreProcessor.Run(FileName, PreProcessedInputFile))
+            if(AssemblerPreProcessor.Run(FileName, PreProcessedInputFile, PreProcessedSource, KeepPreprocessor))
             {
                 if(KeepPreprocessor)
                     fmt::println("Pre-Processed input saved to {FileName}", fmt::arg("FileName", PreProcessedInputFile));
 
-                Result = Assembler(PreProcessedInputFile, InitialProcessor, Listing, Symbols, NoRegisters, NoPorts, OutputFormat).Run();
+                Result = Assembler(PreProcessedInputFile, PreProcessedSource, InitialProcessor, Listing, Symbols, NoRegisters, NoPorts, OutputFormat).Run();
             }
             else
             {
                 fmt::println("Pre-Procssing Failed, Assembly Aborted");
                 fmt::println("");
             }
-
-            if(!KeepPreprocessor)
-                std::remove(PreProcessedInputFile.c_str());
         }
         catch (AssemblyException Error)
         {
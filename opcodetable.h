@@ -1,8 +1,9 @@
 #ifndef OPCODE_H
 #define OPCODE_H
 
-#include <map>
-#include <string>
+#include <cstddef>
+#include <optional>
+#include <string_view>
 
 enum OpCodeEnum
 {
@@ -170,6 +171,17 @@ enum class OpCodeTypeEnum
     PSEUDO_OP                       // Pseudo Operation
 };
 
+enum class OperandTypeEnum
+{
+    NONE,                           // No operand
+    REGISTER,                       // Rn, or'd into the opcode
+    PORT,                           // Pn, or'd into the opcode
+    BYTE,                           // 0xnn
+    SHORT_BRANCH,                   // 0xnn, the low byte of an address in the same page
+    ADDRESS,                        // 0xnnnn
+    REGISTER_WORD                   // Rn, or'd into the opcode, then 0xnnnn
+};
+
 enum class CPUTypeEnum
 {
     CPU_1802  = 0,
@@ -188,9 +200,94 @@ public:
 class OpCodeTable
 {
 public:
-    static const std::map<std::string, OpCodeSpec> OpCode;
-    static const std::map<OpCodeTypeEnum, int> OpCodeBytes;
-    static const std::map<std::string, CPUTypeEnum> CPUTable;
+    struct OpCodeEntry
+    {
+        std::string_view Name;
+        OpCodeSpec Spec;
+    };
+
+    struct CPUEntry
+    {
+        std::string_view Name;
+        CPUTypeEnum CPUType;
+    };
+
+    static std::optional<OpCodeSpec> FindOpCode(std::string_view Mnemonic);
+    static std::optional<CPUTypeEnum> FindCPU(std::string_view Name);
+
+    //!
+    //! \brief The OperandSpec struct
+    //! How an instruction of each OpCodeTypeEnum is encoded: the opcode (one byte, or two
+    //! for the 1806 extended opcodes), followed by the bytes of its operand.
+    //!
+    struct OperandSpec
+    {
+        OperandTypeEnum OperandType;
+        int OpCodeBytes;
+        int OperandBytes;
+        const char* CountError;     // Reported when the number of operands is wrong
+    };
+
+    static constexpr int MaxOpCodeBytes = 4;
+
+    //!
+    //! \brief Operands
+    //! \param OpCodeType
+    //! \return The encoding of an instruction of the given type
+    //!
+    static constexpr const OperandSpec& Operands(OpCodeTypeEnum OpCodeType)
+    {
+        return OperandSpecs[static_cast<int>(OpCodeType)];
+    }
+
+    //!
+    //! \brief OperandCount
+    //! \param OperandType
+    //! \return Number of operands expected
+    //!
+    static constexpr std::size_t OperandCount(OperandTypeEnum OperandType)
+    {
+        switch(OperandType)
+        {
+            case OperandTypeEnum::NONE:             return 0;
+            case OperandTypeEnum::REGISTER_WORD:    return 2;
+            default:                                return 1;
+        }
+    }
+
+    //!
+    //! \brief OpCodeBytes
+    //! \param OpCodeType
+    //! \return
+    //!
+    //! Number of bytes generated for an instruction of the given type (0 for PSEUDO_OP)
+    //!
+    static constexpr int OpCodeBytes(OpCodeTypeEnum OpCodeType)
+    {
+        return Operands(OpCodeType).OpCodeBytes + Operands(OpCodeType).OperandBytes;
+    }
+
+private:
+    // Indexed by OpCodeTypeEnum
+    static constexpr OperandSpec OperandSpecs[] =
+    {
+        { OperandTypeEnum::NONE,          1, 0, "Unexpected operand"                       }, // BASIC
+        { OperandTypeEnum::REGISTER,      1, 0, "Expected single operand of type Register" }, // REGISTER
+        { OperandTypeEnum::BYTE,          1, 1, "Expected single operand of type Byte"     }, // IMMEDIATE
+        { OperandTypeEnum::SHORT_BRANCH,  1, 1, "Short Branch expected single operand"     }, // SHORT_BRANCH
+        { OperandTypeEnum::ADDRESS,       1, 2, "Long Branch expected single operand"      }, // LONG_BRANCH
+        { OperandTypeEnum::PORT,          1, 0, "Expected single operand of type Port"     }, // INPUT_OUTPUT
+        { OperandTypeEnum::NONE,          2, 0, "Unexpected operand"                       }, // EXTENDED
+        { OperandTypeEnum::REGISTER,      2, 0, "Expected single operand of type Register" }, // EXTENDED_REGISTER
+        { OperandTypeEnum::BYTE,          2, 1, "Expected single operand of type Byte"     }, // EXTENDED_IMMEDIATE
+        { OperandTypeEnum::SHORT_BRANCH,  2, 1, "Short Branch expected single operand"     }, // EXTENDED_SHORT_BRANCH
+        { OperandTypeEnum::REGISTER_WORD, 2, 2, "Expected Register and Immediate operands" }, // EXTENDED_REGISTER_IMMEDIATE16
+        { OperandTypeEnum::NONE,          0, 0, ""                                         }  // PSEUDO_OP
+    };
+    static_assert(sizeof(OperandSpecs) / sizeof(OperandSpecs[0]) == static_cast<int>(OpCodeTypeEnum::PSEUDO_OP) + 1, "OperandSpecs must have an entry for each OpCodeTypeEnum");
+
+    static const OpCodeEntry OpCodes[];     // Sorted by Name
+    static const CPUEntry CPUTable[];       // Sorted by Name
 };
 
 #endif // OPCODE_H
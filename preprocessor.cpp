@@ -3,7 +3,6 @@
 #include <fmt/chrono.h>
 #include <fmt/ostream.h>
 #include <fstream>
-#include <regex>
 #include "preprocessor.h"
 #include "preprocessorexception.h"
 #include "preprocessorexpressionevaluator.h"
@@ -12,6 +11,21 @@
 
 namespace fs = std::filesystem;
 
+//!
+//! \brief IdentifierLength
+//! \param Text
+//! \return Length of the variable name ([_A-Za-z][_.A-Za-z0-9]*) at the start of Text, or 0
+//!
+static std::size_t IdentifierLength(const std::string& Text)
+{
+    if(Text.empty() || !(std::isalpha(static_cast<unsigned char>(Text[0])) || Text[0] == '_'))
+        return 0;
+    std::size_t Length = 1;
+    while(Length < Text.size() && (IsWordChar(Text[Length]) || Text[Length] == '.'))
+        Length++;
+    return Length;
+}
+
 const std::map<std::string, PreProcessor::DirectiveEnum> PreProcessor::Directives =
 {
     { "CPU",         DirectiveEnum::PP_processor },
@@ -29,23 +43,45 @@ const std::map<std::string, PreProcessor::DirectiveEnum> PreProcessor::Directive
     { "INCLUDE",     DirectiveEnum::PP_include   },
     { "ERROR",       DirectiveEnum::PP_error     },
     { "LIST",        DirectiveEnum::PP_list      },
-    { "SYMBOLS",     DirectiveEnum::PP_symbols   }
+    { "SYMBOLS",     DirectiveEnum::PP_symbols   },
+    { "PRAGMA",      DirectiveEnum::PP_pragma    }
 };
 
 //!
 //! \brief PreProcessor::SourceEntry::SourceEntry
 //! \param Name
+//! \param File
 //!
 //! Stack Entry for #include'd files
 //!
-PreProcessor::SourceEntry::SourceEntry(const std::string& Name) :
+PreProcessor::SourceEntry::SourceEntry(const std::string& Name, SourceFile& File) :
+    File(&File),
     Name(Name),
     LineNumber(0)
 {
-    Stream = new std::ifstream(Name);
+}
 
-    if(!Stream->good())
-        throw PreProcessorException(Name, 0, fmt::format("File not found: {Name}", fmt::arg("Name", Name)));
+//!
+//! \brief PreProcessor::SourceEntry::GetLine
+//! \param Line
+//! \return False at the end of the file
+//!
+bool PreProcessor::SourceEntry::GetLine(std::string_view& Line)
+{
+    if(NextLine >= File->Contents.LineCount())
+        return false;
+    Line = File->Contents.Line(NextLine++);
+    return true;
+}
+
+//!
+//! \brief PreProcessor::SourceEntry::SetOnce
+//!
+//! Mark the file as #pragma once, so it is not included again
+//!
+void PreProcessor::SourceEntry::SetOnce()
+{
+    File->Once = true;
 }
 
 //!
@@ -74,17 +110,22 @@ void PreProcessor::SetCPU(CPUTypeEnum Processor)
 //! \param OutputFile
 //! \return
 //!
-//! Run the Pre-Processor on InputFile, creating a temporary Pre-Processed file, and return the resultant filename in OutputFile
-bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
+//! Run the Pre-Processor on InputFile, returning the Pre-Processed source in OutputLines.
+//! The name of the Pre-Processed file is returned in OutputFile, and the file is only
+//! written if KeepFile is set.
+bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile, std::vector<std::string>& OutputLines, bool KeepFile)
 {
     auto p = fs::path(InputFile);
     p.replace_extension("pp");
     OutputFile = p;
+    Output = &OutputLines;
+    Output->clear();
 
     try
     {
-        SourceEntry Entry(InputFile);
-        SourceStreams.push(Entry);
+        SourceFile& File = LoadSourceFile(InputFile);
+        File.Included = true;
+        SourceStreams.push(SourceEntry(InputFile, File));
     }
     catch (PreProcessorException Ex)
     {
@@ -92,32 +133,20 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
         return false;
     }
 
-    if(!SourceStreams.top().Stream->good())
-        return false;
-
-    OutputStream = std::ofstream();
-    OutputStream.open(OutputFile, std::ofstream::out | std::ofstream::trunc);
-
-    if(!OutputStream.good())
-        return false;
-
     // Setup stack of #if results
     std::stack<int> IfNestingLevel;
     IfNestingLevel.push(0);
 
-    std::string RawLine;
+    std::string_view RawLine;
     while(SourceStreams.size() > 0)
     {
-        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber + 1);
-        Defines["__FILE__"] = fmt::format("\"{FileName}\"", fmt::arg("FileName", SourceStreams.top().Name));
-        while(std::getline(*SourceStreams.top().Stream, RawLine))
+        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber + 1);
+        while(SourceStreams.top().GetLine(RawLine))
         {
-            std::string Line = RawLine;
+            std::string Line(RawLine);
             SourceStreams.top().LineNumber++;
             try
             {
-                Defines["__LINE__"] = fmt::format("{LineNumber}", fmt::arg("LineNumber", SourceStreams.top().LineNumber));
-
                 // remove last character if blank (<cr>/<lf>/<space>/<tab>
                 while(Line.size() > 0 && (Line[Line.size()-1] == '\r' || Line[Line.size()-1] == '\n' || Line[Line.size()-1] == ' ' || Line[Line.size()-1] == '\t'))
                     Line.pop_back();
@@ -127,20 +156,22 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
 
                 if(IsDirective(Line, Directive, Expression))
                 {
-                    fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                    Output->emplace_back(RawLine);
                     switch(Directive)
                     {
                         case DirectiveEnum::PP_define:
                         {
                             std::string key;
                             std::string value;
-                            std::smatch MatchResult;
-                            if(regex_match(Expression, MatchResult, std::regex(R"(^([_[:alpha:]][_.[:alnum:]]*)\s+(.*)$)")))
+                            auto Length = IdentifierLength(Expression);
+                            if(Length > 0 && Length < Expression.size() && IsSpace(Expression[Length]))
                             {
-                                key = MatchResult[1];
-                                value = MatchResult[2];
+                                key = Expression.substr(0, Length);
+                                while(IsSpace(Expression[Length]))
+                                    Length++;
+                                value = Expression.substr(Length);
                             }
-                            else if(regex_match(Expression, MatchResult, std::regex(R"(^([_[:alpha:]][_.[:alnum:]]*)$)")))
+                            else if(Length > 0 && Length == Expression.size())
                             {
                                 key = Expression;
                                 value = "1";
@@ -153,10 +184,9 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
                         }
                         case DirectiveEnum::PP_undef:
                         {
-                            std::smatch MatchResult;
-                            if(regex_match(Expression, MatchResult, std::regex(R"(^([_[:alpha:]][_.[:alnum:]]*)$)")))
+                            if(IdentifierLength(Expression) > 0 && IdentifierLength(Expression) == Expression.size())
                             {
-                                std::string key = MatchResult[1];
+                                std::string key = Expression;
                                 ToUpper(key);
                                 Defines.erase(key);
                             }
@@ -199,7 +229,7 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
                             if(Expression.empty())
                                 throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected Espression");
                             ToUpper(Expression);
-                            if(Defines.find(Expression) == Defines.end())
+                            if(!IsDefined(Expression))
                             {
                                 if(SkipTo({ DirectiveEnum::PP_else, DirectiveEnum::PP_elif, DirectiveEnum::PP_elifdef, DirectiveEnum::PP_elifndef, DirectiveEnum::PP_endif }) == DirectiveEnum::PP_endif)
                                 {
@@ -215,7 +245,7 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
                             if(Expression.empty())
                                 throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected Espression");
                             ToUpper(Expression);
-                            if(Defines.find(Expression) != Defines.end())
+                            if(IsDefined(Expression))
                             {
                                 if(SkipTo({ DirectiveEnum::PP_else, DirectiveEnum::PP_elif, DirectiveEnum::PP_elifdef, DirectiveEnum::PP_elifndef, DirectiveEnum::PP_endif }) == DirectiveEnum::PP_endif)
                                 {
@@ -267,24 +297,34 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
 
                         case DirectiveEnum::PP_include:
                         {
-                            std::smatch MatchResult;
-                            if(regex_match(Expression, MatchResult, std::regex(R"(^[<\"]([^>\"]+)[>\"]$)")))
+                            if(Expression.size() > 2
+                                && (Expression.front() == '<' || Expression.front() == '\"')
+                                && (Expression.back() == '>' || Expression.back() == '\"')
+                                && Expression.find_first_of(">\"", 1) == Expression.size() - 1)
                             {
                                 if(SourceStreams.size() > 100)
                                     throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Source File Nesting limit exceeded");
 
+                                std::string FileName = Expression.substr(1, Expression.size() - 2);
+                                SourceFile* File;
                                 try
                                 {
-                                    SourceEntry Entry(MatchResult[1]);
-                                    SourceStreams.push(Entry);
-                                    WriteLineMarker(OutputStream, SourceStreams.top().Name, 1);
-                                    IfNestingLevel.push(0);
+                                    File = &LoadSourceFile(FileName);
                                 }
                                 catch(PreProcessorException Ex)
                                 {
                                     throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, Ex.what());
                                 }
 
+                                // A file already included under #pragma once, or whose include guard is defined, would produce nothing
+                                if((File->Once && File->Included) || (!File->Guard.empty() && IsDefined(File->Guard)))
+                                    break;
+
+                                File->Included = true;
+                                SourceStreams.push(SourceEntry(FileName, *File));
+                                WriteLineMarker(SourceStreams.top().Name, 1);
+                                IfNestingLevel.push(0);
+
                             }
                             else
                                 throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Unable to interpret filename expected <filename> or \"filename\"");
@@ -294,10 +334,10 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
                         {
                             std::string Operand = Expression;
                             ToUpper(Operand);
-                            auto CPU = OpCodeTable::CPUTable.find(Operand);
-                            if(CPU == OpCodeTable::CPUTable.end())
+                            auto CPU = OpCodeTable::FindCPU(Operand);
+                            if(!CPU)
                                 throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Unknown processor specification");
-                            Processor = CPU->second;
+                            Processor = CPU.value();
                             break;
                         }
                         case DirectiveEnum::PP_list: // Check syntax and just pass through to main assembler
@@ -306,12 +346,22 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
                         case DirectiveEnum::PP_symbols: // Check syntax and just pass through to main assembler
                             OnOffCheck(Expression);
                             break;
+                        case DirectiveEnum::PP_pragma:
+                        {
+                            std::string Pragma = Expression;
+                            ToUpper(Pragma);
+                            if(Pragma == "ONCE")
+                                SourceStreams.top().SetOnce();
+                            else
+                                throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Unrecognised #pragma");
+                            break;
+                        }
                     }
                 }
                 else
                 {
                     ExpandDefines(Line);
-                    fmt::println(OutputStream, "{Line}", fmt::arg("Line", Line));
+                    Output->push_back(Line);
                 }
             }
             catch (PreProcessorException Ex)
@@ -335,38 +385,173 @@ bool PreProcessor::Run(const std::string& InputFile, std::string& OutputFile)
             ErrorCount++;
         }
         IfNestingLevel.pop();
-        SourceStreams.top().Stream->close();
-        delete SourceStreams.top().Stream;
         SourceStreams.pop();
     }
 
-    OutputStream.close();
+    if(KeepFile)
+    {
+        std::ofstream OutputStream(OutputFile, std::ofstream::out | std::ofstream::trunc);
+        if(!OutputStream.good())
+        {
+            fmt::println("PreProcessor Error: Unable to create {FileName}", fmt::arg("FileName", OutputFile));
+            return false;
+        }
+        for(auto& Line : OutputLines)
+            fmt::println(OutputStream, "{Line}", fmt::arg("Line", Line));
+    }
+
     return ErrorCount == 0;
 }
 
-void PreProcessor::WriteLineMarker(std::ofstream& Output, const std::string& FileName, const int LineNumber)
+void PreProcessor::WriteLineMarker(const std::string& FileName, const int LineNumber)
 {
-    fmt::println(Output, "#line \"{FileName}\" {LineNumber}", fmt::arg("FileName", FileName), fmt::arg("LineNumber", LineNumber));
+    Output->push_back(fmt::format("#line \"{FileName}\" {LineNumber}", fmt::arg("FileName", FileName), fmt::arg("LineNumber", LineNumber)));
+}
+
+//!
+//! \brief PreProcessor::IsDirective
+//! \param Line
+//! \param Directive
+//! \param Expression
+//! \return True if Line is a pre-processor directive
+//!
+bool PreProcessor::IsDirective(std::string_view Line, DirectiveEnum& Directive, std::string& Expression)
+{
+    std::string FirstToken;
+    if(!ParseDirective(Line, FirstToken, Expression))
+        return false;
+
+    auto Entry = Directives.find(FirstToken);
+    if (Entry != Directives.end())
+    {
+        Directive = Entry->second;
+        return true;
+    }
+    throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Unrecognised PreProcessor directive");
+}
+
+//!
+//! \brief PreProcessor::ParseDirective
+//! \param Line
+//! \param Name
+//! \param Expression
+//! \return True if Line has the form #name {expression}
+//!
+//! Split a directive line into its upper case name and its expression, without comments.
+//! Lines not starting with '#' are rejected on the first character.
+//!
+bool PreProcessor::ParseDirective(std::string_view Line, std::string& Name, std::string& Expression)
+{
+    if(Line.empty() || Line[0] != '#')
+        return false;
+
+    std::string TrimmedLine = Trim(std::string(Line));
+    std::size_t Position = 1;
+    while(Position < TrimmedLine.size() && IsWordChar(TrimmedLine[Position]))
+        Position++;
+    if(Position == 1)
+        return false;
+    Name = TrimmedLine.substr(1, Position - 1);
+
+    if(Position < TrimmedLine.size())
+    {
+        if(!IsSpace(TrimmedLine[Position]))
+            return false;
+        while(Position < TrimmedLine.size() && IsSpace(TrimmedLine[Position]))
+            Position++;
+        if(TrimmedLine.find_first_of("\r\n", Position) != std::string::npos)
+            return false;
+    }
+    ToUpper(Name);
+    Expression = TrimmedLine.substr(Position);
+    return true;
 }
 
-bool PreProcessor::IsDirective(const std::string& Line, DirectiveEnum& Directive, std::string& Expression)
+//!
+//! \brief PreProcessor::LoadSourceFile
+//! \param Name
+//! \return
+//!
+//! Return the contents of the named file, reading it from disk only the first time it is used.
+//!
+PreProcessor::SourceFile& PreProcessor::LoadSourceFile(const std::string& Name)
 {
-    std::smatch MatchResult;
-    std::string TrimmedLine = Trim(Line);
-    if(regex_match(TrimmedLine, MatchResult, std::regex(R"(^#(\w+)(\s+(.*))?$)")))
+    std::error_code Error;
+    auto Path = fs::weakly_canonical(Name, Error);
+    std::string Key = Error ? Name : Path.string();
+
+    auto Entry = SourceFiles.find(Key);
+    if(Entry != SourceFiles.end())
+        return Entry->second;
+
+    SourceFile& File = SourceFiles[Key];
+    if(!File.Contents.Load(Name))
     {
-        std::string FirstToken = MatchResult[1];
-        ToUpper(FirstToken);
-        Expression = MatchResult[3];
+        SourceFiles.erase(Key);
+        throw PreProcessorException(Name, 0, fmt::format("File not found: {Name}", fmt::arg("Name", Name)));
+    }
+    FindIncludeGuard(File);
+    return File;
+}
+
+//!
+//! \brief PreProcessor::FindIncludeGuard
+//! \param File
+//!
+//! Set File.Guard if everything in the file, apart from blank lines and comments, is
+//! enclosed in #ifndef Guard / #define Guard ... #endif
+//!
+void PreProcessor::FindIncludeGuard(SourceFile& File)
+{
+    std::string Name;
+    std::string Expression;
+    std::string Guard;
+    int Significant = 0;
+    int Level = 0;
+    bool Closed = false;
 
-        if (Directives.find(FirstToken) != Directives.end())
+    for(std::size_t Index = 0; Index < File.Contents.LineCount(); Index++)
+    {
+        auto Line = File.Contents.Line(Index);
+        if(Trim(std::string(Line)).empty())
+            continue;
+        if(Closed)
+            return;
+
+        bool Directive = ParseDirective(Line, Name, Expression);
+        switch(++Significant)
         {
-            Directive = Directives.at(FirstToken);
-            return true;
+            case 1:
+                if(!Directive || Name != "IFNDEF" || Expression.empty() || IdentifierLength(Expression) != Expression.size())
+                    return;
+                Guard = Expression;
+                ToUpper(Guard);
+                Level = 1;
+                break;
+            case 2:
+            {
+                if(!Directive || Name != "DEFINE")
+                    return;
+                std::string Key = Expression.substr(0, IdentifierLength(Expression));
+                ToUpper(Key);
+                if(Key != Guard)
+                    return;
+                break;
+            }
+            default:
+                if(!Directive)
+                    break;
+                if(Name == "IF" || Name == "IFDEF" || Name == "IFNDEF")
+                    Level++;
+                else if(Name == "ENDIF")
+                    Closed = --Level == 0;
+                else if(Level == 1 && (Name == "ELSE" || Name == "ELIF" || Name == "ELIFDEF" || Name == "ELIFNDEF"))
+                    return;
+                break;
         }
-        throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Unrecognised PreProcessor directive");
     }
-    return false;
+    if(Closed)
+        File.Guard = Guard;
 }
 
 void PreProcessor::AddDefine(const std::string& Identifier, const std::string& Expression)
@@ -385,10 +570,9 @@ void PreProcessor::RemoveDefine(const std::string& Identifier)
 
 void PreProcessor::OnOffCheck(const std::string& Operand)
 {
-    std::smatch MatchResult;
     std::string State = Operand;
     ToUpper(State);
-    if(regex_match(State, MatchResult, std::regex(R"-(^(ON|OFF)$)-")) && (MatchResult[1] == "ON" || MatchResult[1] == "OFF"))
+    if(State == "ON" || State == "OFF")
         return;
     else
         throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected \"ON\" or \"OFF\"");
@@ -397,84 +581,116 @@ void PreProcessor::OnOffCheck(const std::string& Operand)
 //!
 //! \brief ExpandDefines
 //! \param Line
-//! \param Defines
 //!
 //! Parse the given line, replacing any defines with their values
-//! Defines are applied in order of definition, snd are cumulative
 //!
 void PreProcessor::ExpandDefines(std::string& Line)
 {
-    for(auto& Define : Defines)
+    std::string Output;
+    std::vector<std::string_view> Expanding;
+    ExpandDefines(Line, Output, Expanding);
+    Line = std::move(Output);
+}
+
+//!
+//! \brief ExpandDefines
+//! \param Input
+//! \param Output
+//! \param Expanding
+//!
+//! Append Input to Output in a single scan, replacing each identifier outside quotes
+//! that names a define with its value. Values are expanded in turn, except for defines
+//! already being expanded (listed in Expanding), which are left as written.
+//! __LINE__ and __FILE__ are only formatted when they are referenced.
+//!
+void PreProcessor::ExpandDefines(const std::string& Input, std::string& Output, std::vector<std::string_view>& Expanding)
+{
+    bool inSingleQuotes = false;
+    bool inDoubleQuotes = false;
+    bool inEscape = false;
+    for(std::size_t i = 0; i < Input.size(); i++)
     {
-        std::string out;
-        bool inSingleQuotes = false;
-        bool inDoubleQuotes = false;
-        bool inEscape = false;
-        for(int i = 0; i < Line.size(); i++)
-        {
-            char ch = Line[i];
+        char ch = Input[i];
 
-            if(inEscape)
-            {
-                out += ch;
-                inEscape = false;
-            }
-            else if(inSingleQuotes)
-            {
-                out += ch;
+        if(inEscape)
+        {
+            Output += ch;
+            inEscape = false;
+        }
+        else if(inSingleQuotes)
+        {
+            Output += ch;
 
-                if(ch == '\\')
-                    inEscape = true;
+            if(ch == '\\')
+                inEscape = true;
 
-                if(inSingleQuotes && ch == '\'' && !inEscape)
-                    inSingleQuotes = false;
-            }
-            else if(inDoubleQuotes)
-            {
-                out += ch;;
+            if(inSingleQuotes && ch == '\'' && !inEscape)
+                inSingleQuotes = false;
+        }
+        else if(inDoubleQuotes)
+        {
+            Output += ch;
 
-                if(ch == '\\')
-                    inEscape = true;
+            if(ch == '\\')
+                inEscape = true;
 
-                if(inDoubleQuotes && ch == '\"' && !inEscape)
-                    inDoubleQuotes = false;
-            }
-            else if(ch == '\'')
-            {
-                inSingleQuotes = true;
-                out += ch;
-            }
-            else if(ch == '\"')
-            {
-                inDoubleQuotes = true;
-                out += ch;
-            }
+            if(inDoubleQuotes && ch == '\"' && !inEscape)
+                inDoubleQuotes = false;
+        }
+        else if(ch == '\'')
+        {
+            inSingleQuotes = true;
+            Output += ch;
+        }
+        else if(ch == '\"')
+        {
+            inDoubleQuotes = true;
+            Output += ch;
+        }
+        else if(IsWordChar(ch))
+        {
+            std::size_t j = i;
+            while(j < Input.size() && IsWordChar(Input[j]))
+                j++;
+            std::string_view Word(Input.data() + i, j - i);
+            std::string Lookup(Word);
+            ToUpper(Lookup);
+
+            if(Lookup == "__LINE__")
+                Output += std::to_string(SourceStreams.top().LineNumber);
+            else if(Lookup == "__FILE__")
+                Output += fmt::format("\"{FileName}\"", fmt::arg("FileName", SourceStreams.top().Name));
             else
             {
-                std::string FirstWord;
-                int j = i;
-                while(isalnum(Line[j]) || Line[j]=='_')
-                    FirstWord += Line[j++];
-                std::string Lookup = FirstWord;
-                ToUpper(Lookup);
-                if(FirstWord.size() > 0)
+                auto Define = Defines.find(Lookup);
+                if(Define != Defines.end() && std::find(Expanding.begin(), Expanding.end(), Define->first) == Expanding.end())
                 {
-                    if(Lookup == Define.first)
-                    {
-                        out += Define.second;
-                    }
-                    else
-                        out += FirstWord;
-                    i += FirstWord.size() - 1;
+                    Expanding.push_back(Define->first);
+                    ExpandDefines(Define->second, Output, Expanding);
+                    Expanding.pop_back();
                 }
                 else
-                    out += Line[i];
+                    Output += Word;
             }
+            i = j - 1;
         }
-        Line = out;
+        else
+            Output += ch;
     }
 }
 
+//!
+//! \brief IsDefined
+//! \param Identifier
+//! \return True if Identifier (in upper case) is a define
+//!
+bool PreProcessor::IsDefined(const std::string& Identifier)
+{
+    if(Identifier == "__LINE__" || Identifier == "__FILE__")
+        return true;
+    return Defines.find(Identifier) != Defines.end();
+}
+
 //!
 //! \brief SkipLines
 //! \param Source
@@ -484,15 +700,14 @@ void PreProcessor::ExpandDefines(std::string& Line)
 //!
 PreProcessor::DirectiveEnum PreProcessor::SkipTo(const std::set<DirectiveEnum>& Directives)
 {
-    std::string RawLine;
+    std::string_view RawLine;
     DirectiveEnum Directive;
     std::string Expression;
     int Level = 0;
-    while (std::getline(*SourceStreams.top().Stream, RawLine))
+    while (SourceStreams.top().GetLine(RawLine))
     {
         SourceStreams.top().LineNumber++;
-        std::string Line = Trim(RawLine);
-        if (Line.size() > 0 && IsDirective(Line, Directive, Expression))
+        if (IsDirective(RawLine, Directive, Expression))
         {
             switch (Directive)
             {
@@ -507,15 +722,15 @@ PreProcessor::DirectiveEnum PreProcessor::SkipTo(const std::set<DirectiveEnum>&
                         if(ElseCounters.top() != 0)
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Too many #else statements");
                         ElseCounters.top()++;
-                        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber);
-                        fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber);
+                        Output->emplace_back(RawLine);
                     }
                     break;
                 case DirectiveEnum::PP_endif:
                     if (Level == 0)
                     {
-                        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber);
-                        fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber);
+                        Output->emplace_back(RawLine);
                         ElseCounters.pop();
                     }
                     else
@@ -529,8 +744,8 @@ PreProcessor::DirectiveEnum PreProcessor::SkipTo(const std::set<DirectiveEnum>&
                     {
                         if(ElseCounters.top() != 0)
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "#elif must come before #else");
-                        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber);
-                        fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber);
+                        Output->emplace_back(RawLine);
 
                         if(Expression.empty())
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected Espression");
@@ -556,13 +771,13 @@ PreProcessor::DirectiveEnum PreProcessor::SkipTo(const std::set<DirectiveEnum>&
                     {
                         if(ElseCounters.top() != 0)
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "#elif must come before #else");
-                        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber);
-                        fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber);
+                        Output->emplace_back(RawLine);
 
                         if(Expression.empty())
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected Espression");
                         ToUpper(Expression);
-                        if(Defines.find(Expression) == Defines.end())
+                        if(!IsDefined(Expression))
                             return SkipTo({ DirectiveEnum::PP_else, DirectiveEnum::PP_elif, DirectiveEnum::PP_endif });
                         break;
                     }
@@ -571,13 +786,13 @@ PreProcessor::DirectiveEnum PreProcessor::SkipTo(const std::set<DirectiveEnum>&
                     {
                         if(ElseCounters.top() != 0)
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "#elif must come before #else");
-                        WriteLineMarker(OutputStream, SourceStreams.top().Name, SourceStreams.top().LineNumber);
-                        fmt::println(OutputStream, "{Line}", fmt::arg("Line", RawLine));
+                        WriteLineMarker(SourceStreams.top().Name, SourceStreams.top().LineNumber);
+                        Output->emplace_back(RawLine);
 
                         if(Expression.empty())
                             throw PreProcessorException(SourceStreams.top().Name, SourceStreams.top().LineNumber, "Expected Espression");
                         ToUpper(Expression);
-                        if(Defines.find(Expression) != Defines.end())
+                        if(IsDefined(Expression))
                             return SkipTo({ DirectiveEnum::PP_else, DirectiveEnum::PP_elif, DirectiveEnum::PP_endif });
                         break;
                     }
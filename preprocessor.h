@@ -1,12 +1,15 @@
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
 
-#include <fstream>
 #include <map>
 #include <stack>
 #include <string>
 #include <set>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "opcodetable.h"
+#include "sourcebuffer.h"
 
 class PreProcessor
 {
@@ -26,39 +29,58 @@ class PreProcessor
         PP_include,
         PP_error,
         PP_list,
-        PP_symbols
+        PP_symbols,
+        PP_pragma
+    };
+
+    class SourceFile
+    {
+    public:
+        SourceBuffer Contents;
+        std::string Guard;          // Include guard, if the file is wrapped in #ifndef Guard / #define Guard ... #endif
+        bool Once = false;          // #pragma once seen
+        bool Included = false;
     };
 
     class SourceEntry
     {
     private:
+        SourceFile* File;
+        std::size_t NextLine = 0;
     public:
         const std::string Name;
         int LineNumber;
-        std::ifstream* Stream;
 
-        SourceEntry(const std::string& Name);
+        SourceEntry(const std::string& Name, SourceFile& File);
+        bool GetLine(std::string_view& Line);
+        void SetOnce();
     };
 
 public:
     PreProcessor();
     void SetCPU(CPUTypeEnum Processor);
-    bool Run(const std::string& InputFile, std::string& OutputFile);
+    bool Run(const std::string& InputFile, std::string& OutputFile, std::vector<std::string>& OutputLines, bool KeepFile);
     void AddDefine(const std::string& Identifier, const std::string& Expression);
     void RemoveDefine(const std::string& Identifier);
 private:
     std::stack<SourceEntry> SourceStreams;
+    std::map<std::string, SourceFile> SourceFiles;    // File contents, keyed by canonical path
+    SourceFile& LoadSourceFile(const std::string& Name);
+    void FindIncludeGuard(SourceFile& File);
     std::stack<int> ElseCounters;
 
-    std::ofstream OutputStream;
-    inline void WriteLineMarker(std::ofstream& Output, const std::string& FileName, const int LineNumber);
+    std::vector<std::string>* Output = nullptr;
+    inline void WriteLineMarker(const std::string& FileName, const int LineNumber);
 
-    std::map<std::string, std::string> Defines;
+    std::unordered_map<std::string, std::string> Defines;
     CPUTypeEnum Processor = CPUTypeEnum::CPU_1802;
 
     static const std::map<std::string, PreProcessor::DirectiveEnum> Directives;
-    bool IsDirective(const std::string& Line, DirectiveEnum& Directive, std::string& Expression);
+    bool IsDirective(std::string_view Line, DirectiveEnum& Directive, std::string& Expression);
+    static bool ParseDirective(std::string_view Line, std::string& Name, std::string& Expression);
     void ExpandDefines(std::string& Line);
+    void ExpandDefines(const std::string& Input, std::string& Output, std::vector<std::string_view>& Expanding);
+    bool IsDefined(const std::string& Identifier);
     DirectiveEnum SkipTo(const std::set<DirectiveEnum>& Directives);
     void OnOffCheck(const std::string& Operand);
     int ErrorCount = 0;
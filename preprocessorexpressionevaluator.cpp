@@ -11,20 +11,18 @@ const std::map<std::string, PreProcessorExpressionEvaluator::FunctionSpec> PrePr
     { "PROCESSOR",   { FunctionEnum::FN_PROCESSOR, 1 }}
 };
 
-PreProcessorExpressionEvaluator::PreProcessorExpressionEvaluator(const CPUTypeEnum Processor) : ExpressionEvaluatorBase(), Processor(Processor)
+PreProcessorExpressionEvaluator::PreProcessorExpressionEvaluator(const CPUTypeEnum Processor) : ExpressionEvaluatorBase(Processor)
 {
 }
 
 //!
-//! \brief ExpressionEvaluator::TokenValue
+//! \brief ExpressionEvaluator::CompileAtom
 //! Highest Precedence
 //! Constant / Label / Function Call / Bracketed Expression
-//! \return
 //!
-long PreProcessorExpressionEvaluator::AtomValue()
+void PreProcessorExpressionEvaluator::CompileAtom()
 {
-    long Result = 0;
-    auto Token = TokenStream.Get();
+    auto Token = TokenStream->Get();
     switch(Token)
     {
         case ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING:
@@ -32,60 +30,59 @@ long PreProcessorExpressionEvaluator::AtomValue()
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_NUMBER:
-            Result = TokenStream.IntegerValue;
+            Code.Emit(InstructionEnum::OP_PUSH_CONSTANT, TokenStream->IntegerValue);
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE: // Bracketed Expression
-            Result = EvaluateSubExpression();
-            if (TokenStream.Peek() != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+            CompileSubExpression();
+            if (TokenStream->Peek() != ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                 throw ExpressionException("Expected ')'");
             else
-                TokenStream.Get();
+                TokenStream->Get();
             break;
 
         case ExpressionTokenizer::TokenEnum::TOKEN_LABEL:
         {
-            std::string Label = TokenStream.StringValue;
-            if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE)
+            std::string Label(TokenStream->StringValue);
+            if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_OPEN_BRACE)
             {
-                TokenStream.Get();
+                TokenStream->Get();
 
                 auto FunctionSpec = FunctionTable.find(Label);
                 if(FunctionSpec == FunctionTable.end())
                     throw ExpressionException("Unknown function call");
 
-                std::vector<long> Arguments = { };
                 switch(FunctionSpec->second.ID)
                 {
                     case FunctionEnum::FN_LOW:
-                        if(!GetFunctionArguments(Arguments, FunctionSpec->second.Arguments))
+                        if(!GetFunctionArguments(FunctionSpec->second.Arguments))
                             throw ExpressionException("Incorrect number of arguments: LOW expects 1 argument");
-                        Result = Arguments[0] & 0xFF;
+                        Code.Emit(InstructionEnum::OP_LOW);
                         break;
                     case FunctionEnum::FN_HIGH:
-                        if(!GetFunctionArguments(Arguments, FunctionSpec->second.Arguments))
+                        if(!GetFunctionArguments(FunctionSpec->second.Arguments))
                             throw ExpressionException("Incorrect number of arguments: HIGH expects 1 argument");
-                        Result = (Arguments[0] >> 8) & 0xFF;
+                        Code.Emit(InstructionEnum::OP_HIGH);
                         break;
                     case FunctionEnum::FN_PROCESSOR:
                     {
                         std::string Value;
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING)
-                            TokenStream.Get();
-                        else if(!TokenStream.GetCustomToken(std::regex(R"(^(([Cc][Dd][Pp])?180[2456][Aa]?).*)")))
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_QUOTED_STRING)
+                            TokenStream->Get();
+                        else if(!TokenStream->GetProcessorDesignation())
                             throw ExpressionException("Expected Processor designation");
 
-                        Value = TokenStream.StringValue;
+                        Value = TokenStream->StringValue;
                         ToUpper(Value);
 
-                        if(TokenStream.Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
+                        if(TokenStream->Peek() == ExpressionTokenizer::TokenEnum::TOKEN_CLOSE_BRACE)
                         {
-                            TokenStream.Get();
+                            TokenStream->Get();
 
-                            auto CPU = OpCodeTable::CPUTable.find(Value);
-                            if(CPU == OpCodeTable::CPUTable.end())
+                            auto CPU = OpCodeTable::FindCPU(Value);
+                            if(!CPU)
                                 throw ExpressionException("Unrecognised processor designation");
-                            Result = CPU->second <= Processor ? 1 : 0;
+                            Code.Emit(InstructionEnum::OP_PUSH_PROCESSOR, static_cast<long>(CPU.value()));
                         }
                         else
                             throw ExpressionException("Extra characters after Processor designation");
@@ -94,11 +91,10 @@ long PreProcessorExpressionEvaluator::AtomValue()
                 }
             }
             else
-                Result = 0; // Undefined Variable Name has value 0
+                Code.Emit(InstructionEnum::OP_PUSH_CONSTANT, 0); // Undefined Variable Name has value 0
             break;
         }
         default: // Should never happen
             throw ExpressionException("Unsuppoerted operation in expression");
     }
-    return Result;
 }
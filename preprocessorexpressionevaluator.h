@@ -26,8 +26,7 @@ public:
     PreProcessorExpressionEvaluator(const CPUTypeEnum Processor);
 private:
     static const std::map<std::string, FunctionSpec> FunctionTable;
-    const CPUTypeEnum Processor;
-    long AtomValue();
+    void CompileAtom();
 
 };
 
@@ -0,0 +1,102 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "sourcebuffer.h"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCEBUFFER_MMAP
+#endif
+
+SourceBuffer::SourceBuffer()
+{
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    Release();
+}
+
+//!
+//! \brief SourceBuffer::Load
+//! \param FileName
+//! \return False if the file could not be opened
+//!
+//! Map the named file into memory, or read it in one go if it cannot be mapped
+//!
+bool SourceBuffer::Load(const std::string& FileName)
+{
+    Release();
+
+#ifdef SOURCEBUFFER_MMAP
+    int File = open(FileName.c_str(), O_RDONLY);
+    if(File < 0)
+        return false;
+    struct stat Status;
+    if(fstat(File, &Status) == 0 && S_ISREG(Status.st_mode) && Status.st_size > 0)
+    {
+        void* Map = mmap(nullptr, Status.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+        if(Map != MAP_FAILED)
+        {
+            Mapping = Map;
+            Data = static_cast<const char*>(Map);
+            Size = Status.st_size;
+        }
+    }
+    close(File);
+#endif
+
+    if(Mapping == nullptr)
+    {
+        std::ifstream Stream(FileName, std::ios::binary);
+        if(!Stream.good())
+            return false;
+        Text.assign(std::istreambuf_iterator<char>(Stream), std::istreambuf_iterator<char>());
+        Data = Text.data();
+        Size = Text.size();
+    }
+    IndexLines();
+    return true;
+}
+
+//!
+//! \brief SourceBuffer::Release
+//!
+//! Unmap or free the current contents
+//!
+void SourceBuffer::Release()
+{
+#ifdef SOURCEBUFFER_MMAP
+    if(Mapping != nullptr)
+        munmap(Mapping, Size);
+#endif
+    Mapping = nullptr;
+    Text.clear();
+    Data = nullptr;
+    Size = 0;
+    Lines.clear();
+}
+
+//!
+//! \brief SourceBuffer::IndexLines
+//!
+//! Record the position of each line. A final line without a line ending still counts,
+//! as with std::getline.
+//!
+void SourceBuffer::IndexLines()
+{
+    std::size_t Start = 0;
+    while(Start < Size)
+    {
+        auto NewLine = static_cast<const char*>(std::memchr(Data + Start, '\n', Size - Start));
+        std::size_t End = NewLine ? NewLine - Data : Size;
+        std::size_t Length = End - Start;
+        if(Length > 0 && Data[End - 1] == '\r')
+            Length--;
+        Lines.emplace_back(Start, Length);
+        Start = End + 1;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SOURCEBUFFER_H
+#define SOURCEBUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//!
+//! \brief The SourceBuffer class
+//! Holds the text of a source file (memory mapped where possible), with an index of line
+//! positions. Lines are handed out as views without their line ending (\n or \r\n),
+//! and remain valid for the lifetime of the buffer.
+//!
+class SourceBuffer
+{
+public:
+    SourceBuffer();
+    ~SourceBuffer();
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    bool Load(const std::string& FileName);
+    inline std::size_t LineCount() const
+    {
+        return Lines.size();
+    }
+    inline std::string_view Line(std::size_t Index) const
+    {
+        return std::string_view(Data + Lines[Index].first, Lines[Index].second);
+    }
+
+private:
+    const char* Data = nullptr;
+    std::size_t Size = 0;
+    void* Mapping = nullptr;                                // mmap'd file, if any
+    std::string Text;                                       // Contents when not mapped
+    std::vector<std::pair<std::size_t, std::size_t>> Lines; // Offset and length of each line
+    void Release();
+    void IndexLines();
+};
+
+#endif // SOURCEBUFFER_H
@@ -1,63 +1,123 @@
 #include "assemblyexception.h"
 #include "sourcecodereader.h"
 
-SourceCodeReader::SourceEntry::SourceEntry(const std::string& Name) :
-    Name(Name)
+SourceCodeReader::SourceEntry::SourceEntry(SourceNameId Name, const Macro& Definition, const std::vector<std::string>& Operands) :
+    Name(Name),
+    Definition(&Definition),
+    Operands(&Operands)
 {
-    this->Type = SourceType::SOURCE_FILE;
-    Stream = new std::ifstream(Name);
-    if(Stream->fail())
-        throw AssemblyException("Unable to open " + Name, AssemblyErrorSeverity::SEVERITY_Error);
+    this->Type = SourceType::SOURCE_MACRO;
+    LineNumber = 0;
 }
 
-SourceCodeReader::SourceEntry::SourceEntry(const std::string& Name, const std::string& Data) :
-    Name(Name)
+//!
+//! \brief SourceCodeReader::SourceCodeReader
+//! \param Input
+//! \param Program
+//!
+//! Read the Pre-Processed Input, recording each line delivered into Program
+//!
+SourceCodeReader::SourceCodeReader(const std::vector<std::string>& Input, std::deque<SourceLine>& Program) :
+    Input(&Input),
+    Program(Program),
+    Replay(false),
+    Current(&EndOfSource)
 {
-    this->Type = SourceType::SOURCE_MACRO;
-    Stream = new std::istringstream(Data);
-    LineNumber = 0;
+    Program.clear();
 }
 
-SourceCodeReader::SourceCodeReader(const std::string& FileName)
+//!
+//! \brief SourceCodeReader::SourceCodeReader
+//! \param Program
+//!
+//! Replay a Program previously recorded during Pass 1
+//!
+SourceCodeReader::SourceCodeReader(std::deque<SourceLine>& Program) :
+    Program(Program),
+    Replay(true),
+    Current(&EndOfSource)
 {
-    if(SourceStreams.size() > 100)
-        throw AssemblyException("Source File Nesting limit exceeded", AssemblyErrorSeverity::SEVERITY_Error);
-    try
-    {
-        SourceEntry Entry(FileName);
-        SourceStreams.push(Entry);
-    }
-    catch (...)
-    {
-        throw AssemblyException("Unable to open " + FileName, AssemblyErrorSeverity::SEVERITY_Error);
-    }
 }
 
-bool SourceCodeReader::getLine(std::string &Line)
+bool SourceCodeReader::getLine(SourceLine*& Line)
 {
+    if(Replay)
+    {
+        if(Position < Program.size())
+        {
+            Current = &Program[Position++];
+            Line = Current;
+            return true;
+        }
+        Current = &EndOfSource;
+        Line = Current;
+        return false;
+    }
+
     while(SourceStreams.size() > 0)
     {
-        SourceStreams.top().LineNumber++;
-        if(std::getline(*SourceStreams.top().Stream, Line))
+        auto& Top = SourceStreams.top();
+        if(static_cast<std::size_t>(Top.LineNumber) < Top.Definition->LineCount())
         {
-            // remove last character if \n or \r (convert MS-DOS line endings)
-            if(Line.size() > 0 && (Line[Line.size()-1] == '\r' || Line[Line.size()-1] == '\n'))
-                Line.pop_back();
+            std::string Text = Top.Definition->Expand(Top.LineNumber++, *Top.Operands);
+            Program.emplace_back(std::move(Text), Top.Name, Top.LineNumber);
+            Current = &Program.back();
+            Line = Current;
             return true;
         }
         else
-        {
-            delete SourceStreams.top().Stream;
             SourceStreams.pop();
-        }
     }
+
+    if(InputPosition < Input->size())
+    {
+        std::string_view Text = (*Input)[InputPosition++];
+
+        // remove last character if \n or \r (convert MS-DOS line endings)
+        if(Text.size() > 0 && (Text.back() == '\r' || Text.back() == '\n'))
+            Text.remove_suffix(1);
+
+        Program.emplace_back(std::string(Text), SourceNames::None, InputPosition);
+        Current = &Program.back();
+        Line = Current;
+        return true;
+    }
+    Current = &EndOfSource;
+    Line = Current;
     return false;
 }
 
-void SourceCodeReader::InsertMacro(const std::string& Name, const std::string& Data)
+//!
+//! \brief SourceCodeReader::SkipTo
+//! \param Index
+//! \param Line
+//!
+//! When replaying, jump forward to the line recorded at Index in the Program, delivering
+//! it as the current line. Reading continues from the following line.
+//!
+void SourceCodeReader::SkipTo(std::size_t Index, SourceLine*& Line)
+{
+    Position = Index + 1;
+    Current = &Program[Index];
+    Line = Current;
+}
+
+//!
+//! \brief SourceCodeReader::InsertMacro
+//! \param Name
+//! \param Definition
+//! \param Operands
+//!
+//! Push a macro expansion onto the source stack. Each line is spliced together from the
+//! compiled Definition as it is read. The Operands must outlive the expansion, which they do
+//! as they belong to the invoking line in the Program. When replaying, the expansion has
+//! already been recorded following the invoking line, so there is nothing to do.
+//!
+void SourceCodeReader::InsertMacro(const std::string& Name, const Macro& Definition, const std::vector<std::string>& Operands)
 {
+    if(Replay)
+        return;
     if(SourceStreams.size() > 16)
         throw AssemblyException("Maximum Macro nesting level exceeded", AssemblyErrorSeverity::SEVERITY_Error);
-    SourceEntry Entry(Name, Data);
-    SourceStreams.push(Entry);
+    SourceStreams.emplace(SourceNames::Id(Name), Definition, Operands);
 }
@@ -1,18 +1,25 @@
 #ifndef SOURCECODEREADER_H
 #define SOURCECODEREADER_H
 
-#include <fstream>
-#include <sstream>
+#include <deque>
 #include <string>
 #include <stack>
+#include <vector>
+#include "macro.h"
+#include "sourceline.h"
 
+//!
+//! \brief The SourceCodeReader class
+//! During Pass 1, reads the pre-processed source lines (and any inserted macro expansions),
+//! appending each line delivered to the Program. Later passes construct the reader over
+//! the same Program, and simply replay the recorded lines in order.
+//!
 class SourceCodeReader
 {
 public:
     enum class SourceType
     {
         SOURCE_NONE,
-        SOURCE_FILE,
         SOURCE_MACRO
     };
 
@@ -22,33 +29,41 @@ public:
 
     public:
         SourceType Type;
-        std::string Name;
-        std::istream* Stream;
+        SourceNameId Name;
+        const Macro* Definition;                    // Compiled macro being expanded
+        const std::vector<std::string>* Operands;   // Operands of the invoking line, held in the Program
         int LineNumber;
 
-        SourceEntry(const std::string& Name);                           // For the top level File Stream
-        SourceEntry(const std::string& Name, const std::string& Data);  // For Macro Expansions
+        SourceEntry(SourceNameId Name, const Macro& Definition, const std::vector<std::string>& Operands);  // For Macro Expansions
     };
 
 private:
     std::stack<SourceEntry> SourceStreams;
-    const std::string Empty = "";
+    const std::vector<std::string>* Input = nullptr;    // Pre-Processed source lines
+    std::size_t InputPosition = 0;                      // Next source line to read
+    std::deque<SourceLine>& Program;
+    bool Replay;                                        // Replaying a previously recorded Program
+    std::size_t Position = 0;                           // Next line to replay
+    SourceLine* Current;                                // Most recently delivered line
+    SourceLine EndOfSource = SourceLine("", SourceNames::None, 0);
 
 public:
-    SourceCodeReader(const std::string& FileName);
-    void InsertMacro(const std::string& Name, const std::string& Data);
-    bool getLine(std::string& line);
+    SourceCodeReader(const std::vector<std::string>& Input, std::deque<SourceLine>& Program);
+    SourceCodeReader(std::deque<SourceLine>& Program);
+    void InsertMacro(const std::string& Name, const Macro& Definition, const std::vector<std::string>& Operands);
+    bool getLine(SourceLine*& Line);
+    void SkipTo(std::size_t Index, SourceLine*& Line);
+    inline std::size_t Index() const
+    {
+        return Replay ? Position - 1 : Program.size() - 1;
+    }
     inline bool InMacro() const
     {
-        return SourceStreams.size() > 0 ? SourceStreams.top().Type == SourceType::SOURCE_MACRO : false;
+        return Current->InMacro();
     };
-    inline const std::string& StreamName() const
-    {
-        return SourceStreams.size() > 0 ? SourceStreams.top().Name : Empty;
-    }
-    inline const int LineNumber() const
+    inline SourceLocation Location(SourceNameId File, int LineNumber) const
     {
-        return SourceStreams.top().LineNumber;
+        return { File, LineNumber, Current->Macro, Current->MacroLineNumber };
     }
 };
 
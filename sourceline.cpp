@@ -0,0 +1,8 @@
+#include "sourceline.h"
+
+SourceLine::SourceLine(std::string Text, const SourceNameId Macro, const int MacroLineNumber) :
+    Text(std::move(Text)),
+    Macro(Macro),
+    MacroLineNumber(MacroLineNumber)
+{
+}
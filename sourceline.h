@@ -0,0 +1,66 @@
+#ifndef SOURCELINE_H
+#define SOURCELINE_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "assembler.h"
+#include "assemblyexception.h"
+#include "opcodetable.h"
+#include "sourcelocation.h"
+
+//!
+//! \brief The SourceLine class
+//! A single line of pre-processed source, as delivered during Pass 1, together with
+//! the result of lexing it. Later passes replay these records rather than re-reading
+//! and re-lexing the source text.
+//!
+class SourceLine
+{
+public:
+    enum class LineTypeEnum
+    {
+        LINE_EMPTY,         // Blank or comment only
+        LINE_CONTROL,       // Pre-Processor control (#line, #processor, #list, #symbols)
+        LINE_DIRECTIVE,     // Any other # line, passed through to the listing
+        LINE_STATEMENT      // {Label} {Mnemonic {Operands}}
+    };
+
+    SourceLine(std::string Text, const SourceNameId Macro, const int MacroLineNumber);
+
+    // Source stream state
+    const std::string Text;                     // Line as read
+    const SourceNameId Macro;                   // Macro being expanded, if InMacro()
+    const int MacroLineNumber;                  // Line number within the macro expansion
+    inline bool InMacro() const
+    {
+        return Macro != SourceNames::None;
+    }
+
+    // Lexical analysis, populated once by Assembler::Lex
+    bool Lexed = false;
+    LineTypeEnum LineType = LineTypeEnum::LINE_EMPTY;
+    std::string Trimmed;                        // Text with comments and trailing spaces removed
+
+    Assembler::PreProcessorControlEnum Control; // LINE_CONTROL only
+    std::string Expression;                     // Control argument (upper case, except for #line)
+    SourceNameId MarkerFile = SourceNames::None;    // #line file name
+    std::optional<int> MarkerLine;              // #line line number, if well formed
+
+    std::string Label;
+    SymbolId LabelId = 0;                       // Interned Label, if any
+    std::string Mnemonic;
+    std::vector<std::string> Operands;
+    std::optional<OpCodeSpec> OpCode;
+    std::optional<AssemblyException> Error;     // Set if the line could not be split into Label/Mnemonic/Operands
+    std::optional<long> Size;                   // Bytes generated or reserved, recorded by Pass 1 unless they depend on symbols
+
+    // Extent of a SUBROUTINE or MACRO body, recorded by Pass 1 on its opening line
+    std::optional<std::size_t> BodyEnd;         // Program index of the closing ENDSUB / ENDMACRO
+    int BodyEndLineNumber = 0;                  // Line number on reaching the closing line
+    SourceNameId BodyEndFile = SourceNames::None;   // Source file on reaching the closing line
+};
+
+#endif // SOURCELINE_H
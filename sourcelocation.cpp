@@ -0,0 +1,22 @@
+#include <filesystem>
+#include "sourcelocation.h"
+
+std::deque<SourceNames::Entry> SourceNames::Entries = { { "", "" } };
+std::unordered_map<std::string, SourceNameId> SourceNames::Ids = { { "", SourceNames::None } };
+
+//!
+//! \brief SourceNames::Id
+//! \param Name
+//! \return ID of Name, assigning the next one if it has not been seen before
+//!
+SourceNameId SourceNames::Id(const std::string& Name)
+{
+    auto Entry = Ids.find(Name);
+    if(Entry != Ids.end())
+        return Entry->second;
+
+    SourceNameId Id = Entries.size();
+    Entries.push_back({ Name, std::filesystem::path(Name).filename() });
+    Ids.emplace(Name, Id);
+    return Id;
+}
@@ -0,0 +1,60 @@
+#ifndef SOURCELOCATION_H
+#define SOURCELOCATION_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+typedef std::uint32_t SourceNameId;
+
+//!
+//! \brief The SourceNames class
+//! Interns the names of source files and macros, so that source locations can refer to them
+//! by ID. ID 0 is the empty name, used before the first #line marker and for lines that are
+//! not within a macro expansion.
+//!
+class SourceNames
+{
+public:
+    static constexpr SourceNameId None = 0;
+
+    static SourceNameId Id(const std::string& Name);
+    inline static const std::string& Name(SourceNameId Id)
+    {
+        return Entries[Id].Name;
+    }
+    inline static const std::string& FileName(SourceNameId Id)
+    {
+        return Entries[Id].FileName;
+    }
+
+private:
+    struct Entry
+    {
+        std::string Name;
+        std::string FileName;               // Name without its directory, as shown in the listing
+    };
+    static std::deque<Entry> Entries;       // Indexed by ID
+    static std::unordered_map<std::string, SourceNameId> Ids;
+};
+
+//!
+//! \brief The SourceLocation struct
+//! Where a line came from: the file and line number, and for a line of a macro expansion,
+//! the macro and the line within it.
+//!
+struct SourceLocation
+{
+    SourceNameId File = SourceNames::None;
+    int Line = 0;
+    SourceNameId Macro = SourceNames::None;
+    int MacroLine = 0;
+
+    inline bool InMacro() const
+    {
+        return Macro != SourceNames::None;
+    }
+};
+
+#endif // SOURCELOCATION_H
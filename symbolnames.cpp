@@ -0,0 +1,51 @@
+#include <functional>
+#include "symbolnames.h"
+
+std::deque<std::string> SymbolNames::Names;
+std::vector<SymbolNames::Slot> SymbolNames::Slots(1024);
+
+//!
+//! \brief SymbolNames::Id
+//! \param Name
+//! \return ID of Name, assigning the next one if it has not been seen before
+//!
+SymbolId SymbolNames::Id(std::string_view Name)
+{
+    std::size_t Hash = std::hash<std::string_view>()(Name);
+    std::size_t Mask = Slots.size() - 1;
+    for(std::size_t i = Hash & Mask; ; i = (i + 1) & Mask)
+    {
+        Slot& Entry = Slots[i];
+        if(Entry.Id == NoSymbol)
+        {
+            SymbolId Id = Names.size();
+            Names.emplace_back(Name);
+            Entry = { Hash, Id };
+            if(Names.size() * 2 > Slots.size())
+                Grow();
+            return Id;
+        }
+        if(Entry.Hash == Hash && Names[Entry.Id] == Name)
+            return Entry.Id;
+    }
+}
+
+//!
+//! \brief SymbolNames::Grow
+//!
+//! Double the number of slots, placing each name again
+//!
+void SymbolNames::Grow()
+{
+    std::vector<Slot> Old(Slots.size() * 2);
+    Old.swap(Slots);
+    std::size_t Mask = Slots.size() - 1;
+    for(auto& Entry : Old)
+        if(Entry.Id != NoSymbol)
+        {
+            std::size_t i = Entry.Hash & Mask;
+            while(Slots[i].Id != NoSymbol)
+                i = (i + 1) & Mask;
+            Slots[i] = Entry;
+        }
+}
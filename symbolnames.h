@@ -0,0 +1,41 @@
+#ifndef SYMBOLNAMES_H
+#define SYMBOLNAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+typedef std::uint32_t SymbolId;
+
+//!
+//! \brief The SymbolNames class
+//! Interns the names of symbols (already upper case) as 32 bit IDs. Names are interned once,
+//! as source lines are lexed and expressions compiled, so that symbol tables and compiled
+//! expressions refer to symbols by ID rather than comparing strings.
+//!
+class SymbolNames
+{
+public:
+    static constexpr SymbolId NoSymbol = UINT32_MAX;
+
+    static SymbolId Id(std::string_view Name);
+    inline static const std::string& Name(SymbolId Id)
+    {
+        return Names[Id];
+    }
+
+private:
+    struct Slot
+    {
+        std::size_t Hash;
+        SymbolId Id = NoSymbol;
+    };
+    static std::deque<std::string> Names;   // Indexed by ID
+    static std::vector<Slot> Slots;         // Open addressed, a power of two in size and at most half full
+    static void Grow();
+};
+
+#endif // SYMBOLNAMES_H
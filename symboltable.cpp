@@ -1,5 +1,84 @@
+#include <algorithm>
 #include "symboltable.h"
 
 SymbolTable::SymbolTable()
 {
 }
+
+//!
+//! \brief SymbolTable::Symbol
+//! \param Id
+//! \return The symbol, added if it is not defined in the current generation
+//!
+//! The reference is valid until the next symbol is added.
+//!
+SymbolDefinition& SymbolTable::Symbol(SymbolId Id)
+{
+    if((Count + 1) * 2 > Keys.size())
+        Grow();
+    std::size_t Mask = Keys.size() - 1;
+    std::size_t i = Id & Mask;
+    while(Keys[i] != SymbolNames::NoSymbol && Keys[i] != Id)
+        i = (i + 1) & Mask;
+    if(Keys[i] == SymbolNames::NoSymbol)
+    {
+        Keys[i] = Id;
+        Count++;
+    }
+
+    SymbolDefinition& Symbol = Definitions[i];
+    if(Symbol.Generation != Generation && !Symbol.HideFromSymbolTable)
+    {
+        Symbol = SymbolDefinition();
+        Symbol.Generation = Generation;
+    }
+    return Symbol;
+}
+
+//!
+//! \brief SymbolTable::Grow
+//!
+//! Double the number of slots, placing each entry again
+//!
+void SymbolTable::Grow()
+{
+    std::vector<SymbolId> OldKeys(Keys.empty() ? 16 : Keys.size() * 2, SymbolNames::NoSymbol);
+    std::vector<SymbolDefinition> OldDefinitions(OldKeys.size());
+    OldKeys.swap(Keys);
+    OldDefinitions.swap(Definitions);
+    std::size_t Mask = Keys.size() - 1;
+    for(std::size_t Entry = 0; Entry < OldKeys.size(); Entry++)
+        if(OldKeys[Entry] != SymbolNames::NoSymbol)
+        {
+            std::size_t i = OldKeys[Entry] & Mask;
+            while(Keys[i] != SymbolNames::NoSymbol)
+                i = (i + 1) & Mask;
+            Keys[i] = OldKeys[Entry];
+            Definitions[i] = std::move(OldDefinitions[Entry]);
+        }
+}
+
+//!
+//! \brief SymbolTable::Clear
+//!
+//! Forget the symbols, ready for a pass to be repeated, by starting a new generation. The
+//! entries are reused as symbols are defined again. Hidden symbols (i.e. R0-F & P1-7) are kept.
+//!
+void SymbolTable::Clear()
+{
+    Generation++;
+}
+
+//!
+//! \brief SymbolTable::SortedSymbols
+//! \return Name and definition of each symbol in the current generation, in name order
+//!
+std::vector<std::pair<const std::string*, const SymbolDefinition*>> SymbolTable::SortedSymbols() const
+{
+    std::vector<std::pair<const std::string*, const SymbolDefinition*>> Sorted;
+    for(std::size_t i = 0; i < Keys.size(); i++)
+        if(Keys[i] != SymbolNames::NoSymbol && (Definitions[i].Generation == Generation || Definitions[i].HideFromSymbolTable))
+            Sorted.emplace_back(&SymbolNames::Name(Keys[i]), &Definitions[i]);
+    std::sort(Sorted.begin(), Sorted.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+    return Sorted;
+}
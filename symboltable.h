@@ -1,18 +1,44 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 #include "macro.h"
+#include "opcodetable.h"
+#include "symbolnames.h"
+
+class SymbolTable;
+
+//!
+//! \brief The DeferredValue struct
+//! EQU that referred to symbols not yet defined when it was reached in Pass 2. Its expression
+//! is evaluated when the symbol is first used, in the context of the EQU line.
+//!
+struct DeferredValue
+{
+    std::string Expression;
+    uint16_t ProgramCounter;
+    CPUTypeEnum Processor;
+    const SymbolTable* Local;                   // SUBROUTINE holding the EQU, if any
+    std::optional<long> Value = std::nullopt;   // Set once evaluated
+    bool Resolving = false;                     // Set while the expression is evaluated, to detect circular definitions
+    std::string Cycle {};                       // Error for a circular definition it is part of, so it is reported once
+};
 
 struct SymbolDefinition
 {
     std::optional<long> Value;
     bool HideFromSymbolTable = false;
-    mutable int RefCount = 0;
+    std::shared_ptr<DeferredValue> Deferred = nullptr;      // EQU awaiting evaluation, until the end of Pass 2
+    mutable std::set<const SymbolTable*> ReferencedBy {};   // Tables (main code or SUBROUTINE) whose code refers to the symbol
+    unsigned Generation = 0;                                // Table generation in which the symbol was defined
 };
 
 class SymbolTable
@@ -21,11 +47,45 @@ public:
     std::string Name;
     SymbolTable();
 
-    int CodeSize = 0;                                // Size of subroutine code, used when calculating auto alignment
+    std::optional<int> CodeSize;                     // Size of subroutine code, used when calculating auto alignment. Measured in Pass 2 if Pass 1 cannot size every line
     std::string EntryPointLabel;                     // Entry Point, if specifid by ENDSUB ENTRYPOINT = ... parameter
-    std::map<std::string, SymbolDefinition> Symbols; // Symbol Table
     std::map<std::string, Macro> Macros;             // Macro Definitions
     bool Static = false;                             // Keep un-used SUBROUTINEs, if specified by SUBROUTINE STATIC parameter
+
+    //!
+    //! \brief Find
+    //! \param Id
+    //! \return The symbol, or nullptr if it is not defined in the current generation
+    //!
+    inline const SymbolDefinition* Find(SymbolId Id) const
+    {
+        std::size_t Mask = Keys.size() - 1;
+        for(std::size_t i = Id & Mask; !Keys.empty() && Keys[i] != SymbolNames::NoSymbol; i = (i + 1) & Mask)
+            if(Keys[i] == Id)
+            {
+                const SymbolDefinition& Symbol = Definitions[i];
+                if(Symbol.Generation != Generation && !Symbol.HideFromSymbolTable)
+                    return nullptr;
+                return &Symbol;
+            }
+        return nullptr;
+    }
+    inline SymbolDefinition* Find(SymbolId Id)
+    {
+        return const_cast<SymbolDefinition*>(static_cast<const SymbolTable*>(this)->Find(Id));
+    }
+    SymbolDefinition& Symbol(SymbolId Id);
+    void Clear();
+    std::vector<std::pair<const std::string*, const SymbolDefinition*>> SortedSymbols() const;
+
+private:
+    // Symbol Table, including entries left by earlier generations. Open addressed by ID, with
+    // the definition of Keys[i] in Definitions[i]; a power of two in size and at most half full.
+    std::vector<SymbolId> Keys;
+    std::vector<SymbolDefinition> Definitions;
+    std::size_t Count = 0;
+    unsigned Generation = 0;                         // Advanced by Clear()
+    void Grow();
 };
 
 #endif // SYMBOLTABLE_H
@@ -71,3 +71,20 @@ std::string Trim(const std::string& in)
         out.pop_back();
     return out;
 }
+
+//!
+//! \brief IsIdentifier
+//! \param In
+//! \return
+//!
+//! Return true if In is a valid symbol name ([A-Za-z_][A-Za-z0-9_]*)
+//!
+bool IsIdentifier(const std::string& In)
+{
+    if(In.empty() || std::isdigit(static_cast<unsigned char>(In[0])))
+        return false;
+    for(auto Ch : In)
+        if(!IsWordChar(Ch))
+            return false;
+    return true;
+}
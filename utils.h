@@ -2,9 +2,27 @@
 #define UTILS_H
 
 #include <algorithm>
+#include <cctype>
 #include <string>
 
 std::string Trim(const std::string &);
+bool IsIdentifier(const std::string& In);
+
+inline bool IsWordChar(const char Ch)
+{
+    return std::isalnum(static_cast<unsigned char>(Ch)) || Ch == '_';
+}
+
+inline bool IsSpace(const char Ch)
+{
+    return std::isspace(static_cast<unsigned char>(Ch));
+}
+
+inline void TrimRight(std::string& In)
+{
+    while(In.size() > 0 && IsSpace(In.back()))
+        In.pop_back();
+}
 
 inline void ToUpper(std::string& In)
 {